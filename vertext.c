@@ -5,20 +5,63 @@
 #include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <regex.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <termios.h>
 #include <time.h>
 #include <unistd.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSE2__) && defined(__GNUC__) && defined(__linux__)
+#define POPCNT_CLONES __attribute__((target_clones("popcnt", "default")))
+#else
+#define POPCNT_CLONES
+#endif
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
 #define TAB_STOP 8
 #define QUIT_TIMES 2
+#define ROW_BLOCK_SIZE 512
+#define BLOCK_CHUNK_SIZE 512
+#define INDEX_BATCH_BYTES (4 * 1024 * 1024)
+#define INDEX_CHUNK_BYTES (16 * 1024 * 1024)
+#define WORKER_THREADS_MAX 8
+#define REPLACE_PROGRESS_MS 100
+#define UNDO_LIMIT_DEFAULT (64 * 1024 * 1024)
+#define SWAP_MAGIC "VTSWP01"
+#define SWAP_SYNC_MS 1000
+#define SWAP_SYNC_OPS 1024
+#define STATUS_MESSAGE_SECONDS 5
+#define FRAME_INTERVAL_MS 16
+#define INPUT_BUFFER_SIZE 4096
+#define ROW_SLAB_CLASSES 24
+#define ROW_SLAB_SMALL 256
+#define ROW_SLAB_CHUNK (1024 * 1024)
+#define RENDER_CACHE_SIZE 256
+#define SYNTAX_RESYNC_BYTES 1024
+#define SAVE_CHUNK_BYTES (8 * 1024 * 1024)
+#define SAVE_PROGRESS_MS 100
+#define SAVE_COPY_MIN_BYTES (64 * 1024)
 #define CTRL_KEY(k) ((k) & 0x1f)
-#define ABUF_INIT {NULL, 0}
+#define ABUF_INIT {NULL, 0, 0}
 
 enum editorKey{
     BACKSPACE = 127, 
@@ -30,17 +73,345 @@ enum editorKey{
     HOME_KEY, 
     END_KEY, 
     PAGE_UP, 
-    PAGE_DOWN
+    PAGE_DOWN, 
+    PASTE_START, 
+    PASTE_END
 };
 
 typedef struct erow{
     int size;
     int rsize;
+    int capacity;
+    int tabs;
+
+    int words;
+    int characters;
+
+    int renderSlot;
+
+    char mapped;
+    char damaged;
+    char frozen;
+    unsigned char lineState;
 
     char *chars;
-    char *render;
+    int *tabIndex;
 } erow;
 
+typedef struct rowBlock{
+    int count;
+    struct rowBlock *next;
+    erow rows[ROW_BLOCK_SIZE];
+} rowBlock;
+
+struct blockChunk{
+    int count;
+    int numBlocks;
+    rowBlock *blocks[BLOCK_CHUNK_SIZE];
+    int tree[BLOCK_CHUNK_SIZE + 1];
+};
+
+struct appendBuffer{
+    char *buffer;
+    int length;
+    int capacity;
+};
+
+struct frameState{
+    struct appendBuffer *lines;
+    int numLines;
+    int valid;
+
+    struct appendBuffer output;
+    struct appendBuffer line;
+
+    int rowOff, colOff;
+    int cursorRow, cursorColumn;
+    int damageFrom;
+
+    int bytes;
+    long totalBytes;
+
+    int interval;
+    struct timespec painted;
+};
+
+struct perfState{
+    int overlay;
+
+    double frameNs;
+    double scrollNs;
+    double drawNs;
+    double countNs;
+    double writeNs;
+    double latencyNs;
+
+    struct timespec input;
+    int inputPending;
+
+    FILE *trace;
+    struct timespec traceStart;
+    int traceEvents;
+};
+
+struct rowSlab{
+    char *chunk;
+    size_t chunkUsed;
+
+    char **chunks;
+    int numChunks;
+    int chunkCapacity;
+
+    void *freeLists[ROW_SLAB_CLASSES];
+
+    size_t arenaBytes;
+    size_t largeBytes;
+    size_t liveBytes;
+};
+
+struct renderEntry{
+    const char *owner;
+    int start;
+    int length;
+
+    char *buffer;
+    int capacity;
+    unsigned long lastUsed;
+};
+
+struct renderCache{
+    struct renderEntry entries[RENDER_CACHE_SIZE];
+    unsigned long clock;
+};
+
+struct rowGap{
+    char *chars;
+    int start;
+    int length;
+    int tail;
+};
+
+struct indexedLine{
+    size_t offset;
+    int length;
+    int words;
+    int characters;
+    int tabs;
+};
+
+struct indexChunk{
+    size_t start, end;
+
+    struct indexedLine *lines;
+    int count;
+    int capacity;
+    int next;
+    int done;
+};
+
+struct indexState{
+    pthread_t threads[WORKER_THREADS_MAX];
+    int numThreads;
+    pthread_mutex_t lock;
+    int notifyPipe[2];
+
+    struct indexChunk *chunks;
+    int numChunks;
+    int nextChunk;
+    int current;
+    int cancel;
+};
+
+struct retiredChars{
+    char *chars;
+    int capacity;
+};
+
+struct saveState{
+    int active;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    int notifyPipe[2];
+
+    int fd;
+    char *temp;
+    char *target;
+
+    struct iovec *iov;
+    int count;
+    int capacity;
+
+    int source;
+    char *sourceMap;
+    size_t sourceSize;
+
+    long long bytes;
+    long long written;
+    long long reused;
+    int error;
+
+    int dirty;
+    size_t swapLength;
+    struct timespec start;
+
+    struct retiredChars *retired;
+    int numRetired;
+    int retiredCapacity;
+};
+
+struct searchState{
+    char *query;
+    int length;
+    int skip[256];
+
+    int originRow, originColumn;
+    int matchRow, matchColumn;
+
+    int savedCursorX, savedCursorY;
+    int savedRowOff, savedColOff;
+};
+
+struct regexMatch{
+    int row;
+    int start;
+    int end;
+};
+
+struct replaceState;
+
+struct replaceWorker{
+    struct replaceState *state;
+    pthread_t thread;
+    regex_t regex;
+
+    rowBlock *firstBlock;
+    int numBlocks;
+    int firstRow;
+
+    struct regexMatch *matches;
+    int count;
+    int capacity;
+
+    struct regexMatch *published;
+    int numPublished;
+    int publishedCapacity;
+
+    struct regexMatch *pending;
+    int numPending;
+    int applied;
+
+    int rowsScanned;
+    int done;
+};
+
+struct replaceState{
+    struct replaceWorker workers[WORKER_THREADS_MAX];
+    int numWorkers;
+    pthread_mutex_t lock;
+    int cancel;
+};
+
+enum undoType{
+    UNDO_INSERT_TEXT,
+    UNDO_DELETE_TEXT,
+    UNDO_INSERT_ROWS,
+    UNDO_DELETE_ROWS
+};
+
+struct undoRecord{
+    int type;
+    int group;
+    int row;
+    int column;
+    int count;
+    int length;
+    int previous;
+    char typed;
+};
+
+struct undoLog{
+    char *arena;
+    size_t capacity;
+
+    size_t start;
+    size_t position;
+    size_t end;
+    size_t lastSize;
+
+    size_t limit;
+    int group;
+    int skipGroup;
+    int suspended;
+    int sealed;
+};
+
+struct swapHeader{
+    char magic[8];
+    long long size;
+    long long mtime;
+    long long mtimeNsec;
+};
+
+struct swapJournal{
+    char *path;
+    int fd;
+    struct swapHeader header;
+
+    char *buffer;
+    size_t length;
+    size_t capacity;
+    size_t written;
+
+    int records;
+    int unsynced;
+    struct timespec pending;
+};
+
+enum highlightType{
+    HL_NORMAL,
+    HL_COMMENT,
+    HL_KEYWORD,
+    HL_TYPE,
+    HL_STRING,
+    HL_NUMBER,
+    HL_PREPROCESSOR,
+    HL_KEY
+};
+
+enum lineState{
+    LINE_NORMAL,
+    LINE_COMMENT
+};
+
+struct syntaxDefinition{
+    const char *name;
+    const char **extensions;
+    const char **keywords;
+    int multiline;
+    int (*highlight)(const struct syntaxDefinition *syntax, const char *s, int size, int state, unsigned char *hl);
+};
+
+struct syntaxState{
+    const struct syntaxDefinition *definition;
+
+    int computed;
+    int dirtyFrom, dirtyTo;
+
+    char *text;
+    int textCapacity;
+    unsigned char *highlight;
+    int highlightCapacity;
+};
+
+struct inputBuffer{
+    char data[INPUT_BUFFER_SIZE];
+    int start, end;
+
+    const char *script;
+    size_t scriptLength;
+    size_t scriptOffset;
+};
+
 struct editorConfig{
     int cursorX, cursorY;
     int renderX;
@@ -50,21 +421,54 @@ struct editorConfig{
     int screenRows, screenColumns;
 
     int numRows;
-    erow *row;
+    long wordCount, characterCount;
+
+    struct blockChunk **chunks;
+    int numChunks;
+    int chunkCapacity;
+    int *chunkTree;
+    rowBlock *firstBlock;
+    int numBlocks;
+    int lastChunk, lastBlock, lastBlockStart;
+
+    char *map;
+    size_t mapSize;
+    size_t mapIndexed;
+    int mapFd;
+
+    struct indexState index;
+
+    struct rowSlab slab;
+    struct renderCache renderCache;
+    struct rowGap gap;
 
     int dirty;
 
+    struct saveState save;
+
+    struct searchState search;
+
+    struct undoLog undo;
+
+    struct swapJournal swap;
+
+    struct syntaxState syntax;
+
     char *filename;
 
     char statusmsg[80];
     time_t statusmsgTime;
 
-    struct termios origTermios;
-};
+    struct frameState frame;
+    struct perfState perf;
+    long allocations;
+    int headless;
 
-struct appendBuffer{
-    char *buffer;
-    int length;
+    int signalPipe[2];
+
+    struct inputBuffer input;
+
+    struct termios origTermios;
 };
 
 struct editorConfig editor;
@@ -76,54 +480,256 @@ void disableRawMode();
 
 int getCursorPosition(int *rows, int *cols);
 int getWindowSize(int *rows, int *cols);
+void handleWindowChange(int sig);
+void editorResize();
+
+int editorTreeFind(const int *tree, int size, int *remaining);
+void editorTreeAdd(int *tree, int size, int index, int delta);
+void editorTreeBuild(int *tree, int size);
+void editorTreeAppend(int *tree, int size, int value);
+rowBlock *editorFindBlock(int at, int *start);
+void editorBlockTreeAdd(int chunk, int block, int delta);
+void editorChunkTreeRebuild(struct blockChunk *chunk);
+void editorInsertChunk(int at, struct blockChunk *chunk);
+void editorRemoveChunk(int at);
+void editorInsertBlock(int c, int at, rowBlock *block);
+void editorRemoveBlock(int c, int at);
+int editorSlabClass(int size, int *capacity);
+char *editorSlabAlloc(int size, int *capacity);
+void editorSlabFree(char *block, int capacity);
+char *editorSlabGrow(char *block, int *capacity, int used, int needed);
+void editorSlabReset();
+erow *editorRowAt(int at);
+erow *editorRowStoreInsert(int at);
+int editorRowIndex(erow *row);
+void editorRowStoreDelete(int at);
 
 int editorRowcursorXToRx(erow *row, int cursorX);
+int editorRowRxToCursorX(erow *row, int renderX);
+int editorTabSeek(const int *index, int tabs, int field, int value, int sums[2]);
+void editorTabPrefix(const int *index, int count, int sums[2]);
+void editorTabRaw(const int *index, int k, int raw[2]);
+void editorTabStore(int *index, int tabs, int k, int advance, int rebuild);
+void editorTabUnbuild(int *index, int from, int tabs);
+void editorTabBuild(int *index, int from, int tabs);
+int editorTabIndexCapacity(int tabs);
+void editorRowIndexTabs(erow *row);
+void editorRowSpliceTabs(erow *row, int at, int removed, const char *s, int inserted);
 void editorUpdateRow(erow *row);
+void editorGapClose();
+void editorRowMoveGap(erow *row, int at, int needed);
+char *editorRowChars(erow *row);
+char *editorRowRender(erow *row, int start, int width, int *length);
+void editorSyntaxSelect();
+void editorSyntaxReset();
+void editorSyntaxDamage(int at);
+void editorSyntaxShift(int at, int delta);
+const char *editorSyntaxText(erow *row, int from, int to);
+void editorSyntaxUpdate(int to);
+unsigned char *editorSyntaxHighlight(erow *row, int at, int start, int limit, int *from);
+void editorSyntaxMark(unsigned char *hl, int from, int to, int type);
+int editorSyntaxString(const char *s, int size, int at);
+int editorSyntaxKeyword(const struct syntaxDefinition *syntax, const char *word, int length);
+int editorHighlightC(const struct syntaxDefinition *syntax, const char *s, int size, int state, unsigned char *hl);
+int editorHighlightJson(const struct syntaxDefinition *syntax, const char *s, int size, int state, unsigned char *hl);
+int editorHighlightYaml(const struct syntaxDefinition *syntax, const char *s, int size, int state, unsigned char *hl);
 void editorInsertRow(int at, char *s, size_t length);
+void editorAppendMappedRow(char *s, size_t length, int words, int characters, int tabs);
+void editorRowOwn(erow *row);
 void editorFreeRow(erow *row);
+void editorFreeRows();
 void editorDelRow(int at);
 void editorRowInsertChar(erow *row, int at, int character);
+void editorRowInsertString(erow *row, int at, char *s, size_t length);
 void editorRowAppendString(erow *row, char *s, size_t length);
+void editorRowTruncate(erow *row, int at);
 void editorRowDelChar(erow *row, int at);
 void editorInsertChar(int character);
 void editorInsertNewLine();
 void editorDelChar();
-char *editorRowsToString(int *buflen);
-int editorWordCount();
-int editorCharacterCount();
+void editorInsertText(char *s, size_t length);
+int editorIsWordChar(int character);
+int editorWordStarts(int prev, int character);
+void editorCountString(char *s, size_t length, int *words, int *characters);
+void editorRowSetCounts(erow *row, int words, int characters);
+long editorWordCount();
+long editorCharacterCount();
 
 void editorOpen(char *filename);
+int editorIndexPending();
+void editorInitIndex();
+void editorIndexLine(struct indexChunk *chunk, size_t start, size_t end, int words, int characters, int tabs);
+void editorScanChunk(struct indexChunk *chunk);
+void *editorIndexWorker(void *arg);
+void editorStartIndexing();
+void editorStopIndexing();
+struct indexChunk *editorIndexChunk();
+int editorIndexReady();
+void editorIndexWait();
+void editorIndexBatch(size_t bytes);
+void editorLoadRows(int count);
+void editorLoadAllRows();
+int editorWriteAll(int fd, struct iovec *iov, int count);
+void editorRetireChars(char *chars, int capacity);
+void editorSaveAppend(char *chars, size_t length);
+void editorSnapshotRows();
+int editorSaveFromSource(struct saveState *save, struct iovec *iov);
+int editorCopySpan(struct saveState *save, struct iovec *iov);
+int editorSyncDirectory(const char *path);
+void *editorSaveWorker(void *arg);
 void editorSave();
-
+void editorSaveProgress();
+void editorFinishSave();
+void editorSearchCompile(char *query);
+int editorSearchRow(erow *row, int from, int before);
+int editorSearchRowLast(erow *row, int from, int before);
+int editorSearchForward(int row, int column, int endRow, int endColumn);
+int editorSearchBackward(int row, int column);
+void editorSearchJump(int row, int column);
+void editorFindCallback(char *query, int key);
+void editorFind();
+int editorWorkerThreads();
+int editorReplaceMatch(struct replaceWorker *worker, int row, int start, int end);
+void *editorReplaceWorker(void *arg);
+void editorReplaceRow(erow *row, struct regexMatch *matches, int count, char *replacement, int replacementLength);
+int editorReplaceDrain(struct replaceState *state, char *replacement, int replacementLength, int *replaced, int *rows);
+void editorReplace();
+void editorRowDelString(erow *row, int at, int length);
+size_t editorUndoRecordSize(int length);
+struct undoRecord *editorUndoLast();
+void editorUndoReserve(size_t bytes);
+void editorUndoReset();
+void editorUndoEvict();
+void editorUndoRecord(int type, int row, int column, const char *s, int length, int typed);
+void editorUndoApply(struct undoRecord *record, int undo);
+void editorUndo();
+int editorJournaling();
+void editorJournalEdit(int type, int row, int column, const char *s, int length, int typed);
+char *editorSwapPath(char *filename);
+void editorSwapHeader(struct stat *st);
+void editorSwapOpen(char *filename);
+void editorSwapRecord(int type, int row, int column, const char *s, int length);
+int editorSwapWrite();
+void editorSwapCommit();
+void editorSwapSync();
+int editorSwapTimeout();
+void editorSwapRebase(char *filename, size_t keep);
+void editorSwapFail();
+void editorSwapDiscard();
+void editorRedo();
+
+int editorStatusTimeout();
+void editorWaitForInput();
+int editorFillInput(int wait);
+int editorPollEscape(int timeout);
+int editorInputPending();
+int editorFrameDue();
+int editorReadByte(char *character, int wait);
 int editorReadKey();
+char *editorReadPaste(size_t *length);
 void editorProcessKeypress();
 
 void editorScroll();
+void editorDamageRows(int from);
+void editorInvalidateFrame();
+void editorScrollFrame(struct appendBuffer *ab);
+void editorDrawLine(struct appendBuffer *ab, int y, const char *s, int length, const char *style);
+void editorDrawHighlighted(struct appendBuffer *line, erow *row, const char *render, int length, const unsigned char *hl, int from);
 void editorDrawRows(struct appendBuffer *ab);
 void editorDrawStatusBar(struct appendBuffer *ab);
 void editorDrawMessageBar(struct appendBuffer *ab);
-char *editorPrompt(char *prompt);
+char *editorPrompt(char *prompt, void (*callback)(char *, int));
 void editorSetStatusMessage(const char *fmt, ...);
 void editorRefreshScreen();
+double editorPerfPhase(const char *name, struct timespec *start, struct timespec *end);
+void editorTraceClose();
 void editorMoveCursor(int key);
 
 void abAppend(struct appendBuffer *ab, const char *s, int length);
+void abAppendCursor(struct appendBuffer *ab, int row, int column);
+void abRotate(struct appendBuffer *lines, int count, int shift);
 void abFree(struct appendBuffer *ab);
 
 void die(const char *s);
 
+double editorElapsedNs(struct timespec *start, struct timespec *end);
+int editorBenchRows();
+int editorCheckRow(int *ids, int at);
+int editorCheckRowsInsert(int *ids, int at, int id);
+int editorCheckRowsDelete(int *ids, int at);
+int editorCheckRows();
+int editorCheckUndo();
+long long editorBenchFile(char *path, long long size, int lines);
+void editorCloseFile();
+int editorBenchLoad(int argc, char *argv[]);
+int editorLatencyCompare(const void *a, const void *b);
+void editorReplay(const char *name, char *path, const char *script, size_t length);
+char *editorBenchScript(const char *scenario, size_t *length);
+int editorBenchReplay(int argc, char *argv[]);
+int editorBench(int argc, char *argv[]);
+
+const char *cExtensions[] = {".c", ".h", NULL};
+const char *cKeywords[] = {
+    "auto", "break", "case", "const", "continue", "default", "do", "else", "enum", "extern", "for", "goto", "if", "inline", "register", "restrict", "return", "sizeof", "static", "struct", "switch", "typedef", "union", "volatile", "while", "NULL",
+    "_Bool|", "bool|", "char|", "double|", "float|", "int|", "long|", "short|", "signed|", "unsigned|", "void|", "size_t|", "ssize_t|", "off_t|", "int8_t|", "int16_t|", "int32_t|", "int64_t|", "uint8_t|", "uint16_t|", "uint32_t|", "uint64_t|", NULL
+};
+
+const char *jsonExtensions[] = {".json", NULL};
+const char *jsonKeywords[] = {"true", "false", "null", NULL};
+
+const char *yamlExtensions[] = {".yaml", ".yml", NULL};
+const char *yamlKeywords[] = {"true", "false", "null", "yes", "no", "on", "off", "True", "False", "Null", "~", NULL};
+
+struct syntaxDefinition syntaxDefinitions[] = {
+    {"c", cExtensions, cKeywords, 1, editorHighlightC},
+    {"json", jsonExtensions, jsonKeywords, 0, editorHighlightJson},
+    {"yaml", yamlExtensions, yamlKeywords, 0, editorHighlightYaml}
+};
+
+const char *syntaxColors[] = {"\x1b[39m", "\x1b[36m", "\x1b[33m", "\x1b[32m", "\x1b[35m", "\x1b[31m", "\x1b[34m", "\x1b[34m"};
+
 int main(int argc, char *argv[]){
+    if((argc >= 2) && (strcmp(argv[1], "--bench-rows") == 0)){
+        return editorBenchRows();
+    }
+
+    if((argc >= 2) && (strcmp(argv[1], "--check-rows") == 0)){
+        return editorCheckRows();
+    }
+
+    if((argc >= 2) && (strcmp(argv[1], "--check-undo") == 0)){
+        return editorCheckUndo();
+    }
+
+    if((argc >= 2) && (strcmp(argv[1], "--bench-load") == 0)){
+        return editorBenchLoad(argc - 2, argv + 2);
+    }
+
+    if((argc >= 2) && (strcmp(argv[1], "--replay") == 0)){
+        return editorBenchReplay(argc - 2, argv + 2);
+    }
+
+    if((argc >= 2) && (strcmp(argv[1], "--bench") == 0)){
+        return editorBench(argc - 2, argv + 2);
+    }
+
     enableRawMode();
     initEditor();
     if(argc >= 2){
         editorOpen(argv[1]);
     }
 
-    editorSetStatusMessage("HELP: Ctrl-S  = save | Ctrl-Q = quit");
+    if(editor.statusmsg[0] == '\0'){
+        editorSetStatusMessage("HELP: ^S save | ^Q quit | ^F find | ^R replace | ^Z undo | ^Y redo | ^P perf");
+    }
 
     while(1){
         editorRefreshScreen();
-        editorProcessKeypress();
+
+        do{
+            editorProcessKeypress();
+            editorScroll();
+        } while(editorInputPending() && !editorFrameDue());
     }
 
     return 0;
@@ -136,17 +742,101 @@ void initEditor(){
     editor.rowOff = 0;
     editor.colOff = 0;
     editor.numRows = 0;
-    editor.row = NULL;
+    editor.wordCount = 0;
+    editor.characterCount = 0;
+    editor.chunks = NULL;
+    editor.numChunks = 0;
+    editor.chunkCapacity = 0;
+    editor.chunkTree = NULL;
+    editor.firstBlock = NULL;
+    editor.numBlocks = 0;
+    editor.lastChunk = -1;
+    editor.lastBlock = 0;
+    editor.lastBlockStart = 0;
+    editor.map = NULL;
+    editor.mapSize = 0;
+    editor.mapIndexed = 0;
+    editor.mapFd = -1;
+    memset(&editor.slab, 0, sizeof(editor.slab));
+    memset(&editor.renderCache, 0, sizeof(editor.renderCache));
     editor.dirty = 0;
     editor.filename = NULL;
     editor.statusmsg[0] = '\0';
     editor.statusmsgTime = 0;
-
-    if(getWindowSize(&editor.screenRows, &editor.screenColumns) == -1){
+    editor.frame.lines = NULL;
+    editor.frame.numLines = 0;
+    editor.frame.valid = 0;
+    editor.frame.damageFrom = INT_MAX;
+    editor.frame.bytes = 0;
+    editor.frame.totalBytes = 0;
+    editor.frame.interval = FRAME_INTERVAL_MS;
+    editor.input.start = 0;
+    editor.input.end = 0;
+
+    if(editor.headless){
+        editor.screenRows = 24;
+        editor.screenColumns = 80;
+    }
+    else if(getWindowSize(&editor.screenRows, &editor.screenColumns) == -1){
         die("getWindowSize");
     }
 
     editor.screenRows -= 2;
+
+    if(pipe(editor.signalPipe) == -1){
+        die("pipe");
+    }
+
+    fcntl(editor.signalPipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(editor.signalPipe[1], F_SETFL, O_NONBLOCK);
+
+    if(pipe(editor.save.notifyPipe) == -1){
+        die("pipe");
+    }
+
+    fcntl(editor.save.notifyPipe[0], F_SETFL, O_NONBLOCK);
+    pthread_mutex_init(&editor.save.lock, NULL);
+
+    editorInitIndex();
+
+    char *limit = getenv("VERTEXT_UNDO_LIMIT");
+
+    memset(&editor.undo, 0, sizeof(editor.undo));
+    editor.undo.limit = (limit != NULL) ? strtoull(limit, NULL, 10) : UNDO_LIMIT_DEFAULT;
+    editor.undo.skipGroup = -1;
+
+    memset(&editor.swap, 0, sizeof(editor.swap));
+    editor.swap.fd = -1;
+
+    memset(&editor.syntax, 0, sizeof(editor.syntax));
+    editorSyntaxReset();
+
+    char *interval = getenv("VERTEXT_FRAME_MS");
+
+    if((interval != NULL) && (atoi(interval) >= 0)){
+        editor.frame.interval = atoi(interval);
+    }
+
+    char *trace = getenv("VERTEXT_TRACE");
+
+    memset(&editor.perf, 0, sizeof(editor.perf));
+
+    if((trace != NULL) && ((editor.perf.trace = fopen(trace, "w")) != NULL)){
+        fputs("[\n", editor.perf.trace);
+        clock_gettime(CLOCK_MONOTONIC, &editor.perf.traceStart);
+
+        atexit(editorTraceClose);
+    }
+
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handleWindowChange;
+    sigemptyset(&sa.sa_mask);
+
+    if(sigaction(SIGWINCH, &sa, NULL) == -1){
+        die("sigaction");
+    }
 }
 
 void enableRawMode(){
@@ -168,9 +858,13 @@ void enableRawMode(){
     if(tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == -1){
         die("tcsetattr");
     }
+
+    write(STDOUT_FILENO, "\x1b[?2004h", 8);
 }
 
 void disableRawMode(){
+    write(STDOUT_FILENO, "\x1b[?2004l", 8);
+
     if(tcsetattr(STDIN_FILENO, TCSAFLUSH, &editor.origTermios) == -1){
         die("tcsetattr");
     }
@@ -226,701 +920,5374 @@ int getWindowSize(int *rows, int *cols){
     }
 }
 
-int editorRowcursorXToRx(erow *row, int cursorX){
-    int renderX = 0;
-
-    for(int i = 0; i < cursorX; i++){
-        if(row->chars[i] == '\t'){
-            renderX += (TAB_STOP - 1) - (renderX % TAB_STOP);
-        }
+void handleWindowChange(int sig){
+    int savedErrno = errno;
 
-        renderX++;
-    }
+    (void)sig;
+    write(editor.signalPipe[1], "w", 1);
 
-    return renderX;
+    errno = savedErrno;
 }
 
-void editorUpdateRow(erow *row){
-    int tabs = 0;
-    for(int i = 0; i < row->size; i++){
-        if(row->chars[i] == '\t'){
-            tabs++;
-        }
-    }
+void editorResize(){
+    int rows, cols;
 
-    free(row->render);
-    row->render = malloc(row->size + (tabs * (TAB_STOP - 1)) + 1);
+    if(getWindowSize(&rows, &cols) == -1){
+        return;
+    }
 
-    int idx = 0;
-    for(int i = 0; i < row->size; i++){
-        if(row->chars[i] == '\t'){
-            row->render[idx++] = ' ';
+    editor.screenRows = rows - 2;
+    editor.screenColumns = cols;
 
-            while((idx % TAB_STOP) != 0){
-                row->render[idx++] = ' ';
-            }
-        }
-        else{
-            row->render[idx++] = row->chars[i];
-        }
+    if(editor.screenRows < 1){
+        editor.screenRows = 1;
     }
-    row->render[idx] = '\0';
-    row->rsize = idx;
+
+    editorInvalidateFrame();
 }
 
-void editorInsertRow(int at, char *s, size_t length){
-    if((at < 0) || (at > editor.numRows)){
-        return;
+int editorTreeFind(const int *tree, int size, int *remaining){
+    int step = 1;
+    while((step << 1) <= size){
+        step <<= 1;
     }
 
-    editor.row = realloc(editor.row, sizeof(erow) * (editor.numRows + 1));
+    int pos = 0;
 
-    memmove(&editor.row[at + 1], &editor.row[at], sizeof(erow) * (editor.numRows - at));
+    for(; step > 0; step >>= 1){
+        if((pos + step <= size) && (tree[pos + step] <= *remaining)){
+            pos += step;
+            *remaining -= tree[pos];
+        }
+    }
 
-    editor.row[at].size = length;
-    editor.row[at].chars = malloc(length + 1);
-    
-    memcpy(editor.row[at].chars, s, length);
-    editor.row[at].chars[length] = '\0';
+    return pos;
+}
 
-    editor.row[at].rsize = 0;
-    editor.row[at].render = NULL;
+void editorTreeAdd(int *tree, int size, int index, int delta){
+    for(int i = index + 1; i <= size; i += (i & -i)){
+        tree[i] += delta;
+    }
+}
 
-    editorUpdateRow(&editor.row[at]);
+void editorTreeBuild(int *tree, int size){
+    for(int i = 1; i <= size; i++){
+        int parent = i + (i & -i);
 
-    editor.numRows++;
-    editor.dirty++;
+        if(parent <= size){
+            tree[parent] += tree[i];
+        }
+    }
 }
 
-void editorFreeRow(erow *row){
-    free(row->render);
-    free(row->chars);
-}
+void editorTreeAppend(int *tree, int size, int value){
+    tree[size] = value;
 
-void editorDelRow(int at){
-    if((at < 0) || (at >= editor.numRows)){
-        return;
+    for(int i = size - 1; i > size - (size & -size); i -= (i & -i)){
+        tree[size] += tree[i];
     }
+}
 
-    editorFreeRow(&editor.row[at]);
+rowBlock *editorFindBlock(int at, int *start){
+    if((editor.lastChunk >= 0) && (editor.lastChunk < editor.numChunks) && (editor.lastBlock < editor.chunks[editor.lastChunk]->numBlocks)){
+        rowBlock *block = editor.chunks[editor.lastChunk]->blocks[editor.lastBlock];
+        int lastEnd = editor.lastBlockStart + block->count;
 
-    memmove(&editor.row[at], &editor.row[at + 1], sizeof(erow) * (editor.numRows - at - 1));
+        if((at >= editor.lastBlockStart) && (at < lastEnd)){
+            *start = editor.lastBlockStart;
 
-    editor.numRows--;
-    editor.dirty++;
-}
+            return block;
+        }
 
-void editorRowInsertChar(erow *row, int at, int character){
-    if((at < 0) || (at > row->size)){
-        at = row->size;
+        if((at == lastEnd) && (block->next != NULL)){
+            if(++editor.lastBlock == editor.chunks[editor.lastChunk]->numBlocks){
+                editor.lastChunk++;
+                editor.lastBlock = 0;
+            }
+
+            editor.lastBlockStart = lastEnd;
+            *start = lastEnd;
+
+            return block->next;
+        }
     }
 
-    row->chars = realloc(row->chars, row->size + 2);
+    int remaining = at;
+    int c = editorTreeFind(editor.chunkTree, editor.numChunks, &remaining);
 
-    memmove(&row->chars[at + 1], &row->chars[at], row->size - at + 1);
+    if(c >= editor.numChunks){
+        c = editor.numChunks - 1;
+        remaining += editor.chunks[c]->count;
+    }
 
-    row->size++;
-    row->chars[at] = character;
+    struct blockChunk *chunk = editor.chunks[c];
+    int b = editorTreeFind(chunk->tree, chunk->numBlocks, &remaining);
 
-    editorUpdateRow(row);
+    if(b >= chunk->numBlocks){
+        b = chunk->numBlocks - 1;
+        remaining += chunk->blocks[b]->count;
+    }
 
-    editor.dirty++;
+    editor.lastChunk = c;
+    editor.lastBlock = b;
+    editor.lastBlockStart = at - remaining;
+    *start = editor.lastBlockStart;
+
+    return chunk->blocks[b];
 }
 
-void editorRowAppendString(erow *row, char *s, size_t length){
-    row->chars = realloc(row->chars, row->size + length + 1);
+void editorBlockTreeAdd(int chunk, int block, int delta){
+    struct blockChunk *c = editor.chunks[chunk];
 
-    memcpy(&row->chars[row->size], s, length);
+    editorTreeAdd(c->tree, c->numBlocks, block, delta);
+    c->count += delta;
 
-    row->size += length;
-    row->chars[row->size] = '\0';
+    editorTreeAdd(editor.chunkTree, editor.numChunks, chunk, delta);
+}
 
-    editorUpdateRow(row);
+void editorChunkTreeRebuild(struct blockChunk *chunk){
+    for(int i = 1; i <= chunk->numBlocks; i++){
+        chunk->tree[i] = chunk->blocks[i - 1]->count;
+    }
 
-    editor.dirty++;
+    editorTreeBuild(chunk->tree, chunk->numBlocks);
 }
 
-void editorRowDelChar(erow *row, int at){
-    if((at < 0) || (at >= row->size)){
-        return;
+void editorInsertChunk(int at, struct blockChunk *chunk){
+    if(editor.numChunks == editor.chunkCapacity){
+        editor.chunkCapacity = editor.chunkCapacity ? (editor.chunkCapacity * 2) : 4;
+        editor.chunks = realloc(editor.chunks, sizeof(struct blockChunk *) * editor.chunkCapacity);
+        editor.chunkTree = realloc(editor.chunkTree, sizeof(int) * (editor.chunkCapacity + 1));
     }
 
-    memmove(&row->chars[at], &row->chars[at+1], row->size - at);
+    memmove(&editor.chunks[at + 1], &editor.chunks[at], sizeof(struct blockChunk *) * (editor.numChunks - at));
+    editor.chunks[at] = chunk;
+    editor.numChunks++;
 
-    row->size--;
+    if(at + 1 < editor.numChunks){
+        for(int i = 1; i <= editor.numChunks; i++){
+            editor.chunkTree[i] = editor.chunks[i - 1]->count;
+        }
 
-    editorUpdateRow(row);
+        editorTreeBuild(editor.chunkTree, editor.numChunks);
+    }
+    else{
+        editorTreeAppend(editor.chunkTree, editor.numChunks, chunk->count);
+    }
 
-    editor.dirty++;
+    editor.lastChunk = -1;
 }
 
-void editorInsertChar(int character){
-    if(editor.cursorY == editor.numRows){
-        editorInsertRow(editor.numRows, "", 0);
+void editorRemoveChunk(int at){
+    free(editor.chunks[at]);
+
+    memmove(&editor.chunks[at], &editor.chunks[at + 1], sizeof(struct blockChunk *) * (editor.numChunks - at - 1));
+    editor.numChunks--;
+
+    if(at < editor.numChunks){
+        for(int i = 1; i <= editor.numChunks; i++){
+            editor.chunkTree[i] = editor.chunks[i - 1]->count;
+        }
+
+        editorTreeBuild(editor.chunkTree, editor.numChunks);
     }
 
-    editorRowInsertChar(&editor.row[editor.cursorY], editor.cursorX, character);
-    editor.cursorX++;
+    editor.lastChunk = -1;
 }
 
-void editorInsertNewLine(){
-    if(editor.cursorX == 0){
-        editorInsertRow(editor.cursorY, "", 0);
+void editorInsertBlock(int c, int at, rowBlock *block){
+    if(editor.numChunks == 0){
+        struct blockChunk *chunk = malloc(sizeof(struct blockChunk));
+        chunk->count = 0;
+        chunk->numBlocks = 0;
+
+        editorInsertChunk(0, chunk);
     }
-    else{
-        erow *row = &editor.row[editor.cursorY];
 
-        editorInsertRow(editor.cursorY + 1, &row->chars[editor.cursorX], row->size - editor.cursorX);
+    struct blockChunk *chunk = editor.chunks[c];
+
+    if(chunk->numBlocks == BLOCK_CHUNK_SIZE){
+        struct blockChunk *next = malloc(sizeof(struct blockChunk));
+        int half = (at == BLOCK_CHUNK_SIZE) ? BLOCK_CHUNK_SIZE : (BLOCK_CHUNK_SIZE / 2);
+
+        next->numBlocks = BLOCK_CHUNK_SIZE - half;
+        next->count = 0;
+        memcpy(next->blocks, &chunk->blocks[half], sizeof(rowBlock *) * next->numBlocks);
+
+        for(int i = 0; i < next->numBlocks; i++){
+            next->count += next->blocks[i]->count;
+        }
+
+        editorTreeAdd(editor.chunkTree, editor.numChunks, c, -next->count);
+        chunk->count -= next->count;
+        chunk->numBlocks = half;
+        editorChunkTreeRebuild(next);
 
-        row = &editor.row[editor.cursorY];
-        row->size = editor.cursorX;
-        row->chars[row->size] = '\0';
-        editorUpdateRow(row);
+        editorInsertChunk(c + 1, next);
+
+        if(at >= half){
+            c++;
+            at -= half;
+            chunk = next;
+        }
     }
 
-    editor.cursorY++;
-    editor.cursorX = 0;
-}
+    rowBlock *prev = NULL;
 
-void editorDelChar(){
-    if(editor.cursorY == editor.numRows){
-        return;
+    if(at > 0){
+        prev = chunk->blocks[at - 1];
+    }
+    else if(c > 0){
+        prev = editor.chunks[c - 1]->blocks[editor.chunks[c - 1]->numBlocks - 1];
     }
 
-    if((editor.cursorX == 0) && (editor.cursorY == 0)){
-        return;
+    if(prev != NULL){
+        block->next = prev->next;
+        prev->next = block;
+    }
+    else{
+        block->next = editor.firstBlock;
+        editor.firstBlock = block;
     }
 
-    erow *row = &editor.row[editor.cursorY];
+    memmove(&chunk->blocks[at + 1], &chunk->blocks[at], sizeof(rowBlock *) * (chunk->numBlocks - at));
+    chunk->blocks[at] = block;
+    chunk->numBlocks++;
 
-    if(editor.cursorX > 0){
-        editorRowDelChar(row, editor.cursorX - 1);
-        editor.cursorX--;
+    if(at + 1 < chunk->numBlocks){
+        editorChunkTreeRebuild(chunk);
     }
     else{
-        editor.cursorX = editor.row[editor.cursorY - 1].size;
+        editorTreeAppend(chunk->tree, chunk->numBlocks, block->count);
+    }
 
-        editorRowAppendString(&editor.row[editor.cursorY - 1], row->chars, row->size);
-        editorDelRow(editor.cursorY);
+    chunk->count += block->count;
+    editorTreeAdd(editor.chunkTree, editor.numChunks, c, block->count);
 
-        editor.cursorY--;
-    }
+    editor.numBlocks++;
+    editor.lastChunk = c;
+    editor.lastBlock = at;
 }
 
-char *editorRowsToString(int *buflen){
-    int totlen = 0;
+void editorRemoveBlock(int c, int at){
+    struct blockChunk *chunk = editor.chunks[c];
+    rowBlock *block = chunk->blocks[at];
 
-    for(int i = 0; i < editor.numRows; i++){
-        totlen += editor.row[i].size + 1;
+    if(at > 0){
+        chunk->blocks[at - 1]->next = block->next;
+    }
+    else if(c > 0){
+        editor.chunks[c - 1]->blocks[editor.chunks[c - 1]->numBlocks - 1]->next = block->next;
+    }
+    else{
+        editor.firstBlock = block->next;
     }
 
-    *buflen = totlen;
+    editorBlockTreeAdd(c, at, -block->count);
 
-    char *buf = malloc(totlen);
-    char *p = buf;
+    memmove(&chunk->blocks[at], &chunk->blocks[at + 1], sizeof(rowBlock *) * (chunk->numBlocks - at - 1));
+    chunk->numBlocks--;
 
-    for(int i = 0; i < editor.numRows; i++){
-        memcpy(p, editor.row[i].chars, editor.row[i].size);
-        p += editor.row[i].size;
-        *p = '\n';
-        p++;
+    if(at < chunk->numBlocks){
+        editorChunkTreeRebuild(chunk);
     }
 
-    return buf;
-}
+    free(block);
+    editor.numBlocks--;
+    editor.lastChunk = -1;
 
-int editorWordCount(){
-    int count = 0;
-    int isInWord = 0;
+    if(chunk->numBlocks == 0){
+        editorRemoveChunk(c);
+    }
+    else if((c + 1 < editor.numChunks) && (chunk->numBlocks + editor.chunks[c + 1]->numBlocks <= BLOCK_CHUNK_SIZE / 2)){
+        struct blockChunk *next = editor.chunks[c + 1];
 
-    for(int i = 0; i < editor.numRows; i++){
-        erow *row = &editor.row[i];
+        memcpy(&chunk->blocks[chunk->numBlocks], next->blocks, sizeof(rowBlock *) * next->numBlocks);
+        chunk->numBlocks += next->numBlocks;
+        editorChunkTreeRebuild(chunk);
 
-        for(int j = 0; j < row->size; j++){
-            int character = row->chars[j];
+        chunk->count += next->count;
+        editorTreeAdd(editor.chunkTree, editor.numChunks, c, next->count);
 
-            if(isspace(character)){
-                isInWord = 0;
-            }
-            else if(!isInWord){
-                count++;
-                isInWord = 1;
-            }
-        }
+        editorRemoveChunk(c + 1);
     }
-
-    return count;
 }
 
-int editorCharacterCount(){
-    int count = 0;
-
-    for(int i = 0; i < editor.numRows; i++){
-        erow *row = &editor.row[i];
+int editorSlabClass(int size, int *capacity){
+    if(size <= ROW_SLAB_SMALL){
+        int index = (size > 0) ? ((size - 1) / 16) : 0;
 
-        for(int j = 0; j < row->size; j++){
-            int character = row->chars[j];
+        *capacity = (index + 1) * 16;
 
-            if(!isspace(character)){
-                count++;
-            }
-        }
+        return index;
     }
 
-    return count;
-}
-
-void editorOpen(char *filename){
-    free(editor.filename);
-    editor.filename = strdup(filename);
-
-    FILE *fp = fopen(filename, "r");
+    int index = ROW_SLAB_SMALL / 16;
 
-    if(!fp){
-        die("fopen");
+    for(*capacity = ROW_SLAB_SMALL * 2; *capacity < size; *capacity *= 2){
+        index++;
     }
 
-    char *line = NULL;
-    size_t linecap = 0;
-    ssize_t linelen;
-
-    while((linelen = getline(&line, &linecap, fp)) != -1){
-        while((linelen > 0) && ((line[linelen - 1] == '\n') || (line[linelen - 1] == '\r'))){
-            linelen--;
-        }
+    if(index >= ROW_SLAB_CLASSES){
+        *capacity = size;
 
-        editorInsertRow(editor.numRows, line, linelen);
+        return -1;
     }
 
-    free(line);
-    fclose(fp);
-
-    editor.dirty = 0;
+    return index;
 }
 
-void editorSave(){
-    if(editor.filename == NULL){
-        editor.filename = editorPrompt("Save as: %s");
-
-        if(editor.filename == NULL){
-            editorSetStatusMessage("Save aborted");
+char *editorSlabAlloc(int size, int *capacity){
+    struct rowSlab *slab = &editor.slab;
+    int index = editorSlabClass(size, capacity);
 
-            return;
-        }
-    }
+    slab->liveBytes += *capacity;
 
-    int length;
-    char *buf = editorRowsToString(&length);
+    if(index == -1){
+        slab->largeBytes += *capacity;
 
-    int fd = open(editor.filename, O_RDWR | O_CREAT, 0644);
+        return malloc(*capacity);
+    }
 
-    if(fd != -1){
-        if(ftruncate(fd, length) != -1){
-            if(write(fd, buf, length) == length){
-                close(fd);
-                free(buf);
+    if(slab->freeLists[index] != NULL){
+        char *block = slab->freeLists[index];
 
-                editor.dirty = 0;
+        memcpy(&slab->freeLists[index], block, sizeof(void *));
 
-                editorSetStatusMessage("%d bytes written to disk", length);
+        return block;
+    }
 
-                return;
-            }
+    if((slab->chunk == NULL) || (slab->chunkUsed + *capacity > ROW_SLAB_CHUNK)){
+        if(slab->numChunks == slab->chunkCapacity){
+            slab->chunkCapacity = slab->chunkCapacity ? (slab->chunkCapacity * 2) : 16;
+            slab->chunks = realloc(slab->chunks, sizeof(char *) * slab->chunkCapacity);
         }
 
-        close(fd);
+        slab->chunk = malloc(ROW_SLAB_CHUNK);
+        slab->chunkUsed = 0;
+        slab->chunks[slab->numChunks++] = slab->chunk;
+        slab->arenaBytes += ROW_SLAB_CHUNK;
     }
 
-    free(buf);
+    char *block = &slab->chunk[slab->chunkUsed];
+    slab->chunkUsed += *capacity;
 
-    editorSetStatusMessage("Can't save! I/O error: %s", strerror(errno));
+    return block;
 }
 
-int editorReadKey(){
-    int nread;
-    char character;
+void editorSlabFree(char *block, int capacity){
+    struct rowSlab *slab = &editor.slab;
 
-    while((nread = read(STDIN_FILENO, &character, 1)) != 1){
-        if((nread == -1) && (errno != EAGAIN)){
-            die("read");
-        }
+    if(block == NULL){
+        return;
     }
 
-    if(character == '\x1b'){
-        char seq[3];
+    int classCapacity;
+    int index = editorSlabClass(capacity, &classCapacity);
 
-        if(read(STDIN_FILENO, &seq[0], 1) != 1){
-            return '\x1b';
-        }
+    slab->liveBytes -= capacity;
 
-        if(read(STDIN_FILENO, &seq[1], 1) != 1){
-            return '\x1b';
-        }
+    if(index == -1){
+        slab->largeBytes -= capacity;
+        free(block);
 
-        if(seq[0] == '['){
-            if(seq[1] >= '0' && seq[1] <= '9'){
-                if(read(STDIN_FILENO, &seq[2], 1) != 1){
-                    return '\x1b';
-                }
+        return;
+    }
 
-                if(seq[2] == '~'){
-                    switch(seq[1]){
-                        case '1': return HOME_KEY;
-                        case '3': return DEL_KEY;
-                        case '4': return END_KEY;
-                        case '5': return PAGE_UP;
-                        case '6': return PAGE_DOWN;
-                        case '7': return HOME_KEY;
-                        case '8': return END_KEY;
-                    }
-                }
-            }
-            else{
-                switch(seq[1]){
-                    case 'A': return ARROW_UP;
-                    case 'B': return ARROW_DOWN;
-                    case 'C': return ARROW_RIGHT;
-                    case 'D': return ARROW_LEFT;
-                    case 'H': return HOME_KEY;
-                    case 'F': return END_KEY;
-                }
-            }
-        }
-        else if(seq[0] == 'O'){
-            switch(seq[1]){
-                case 'H': return HOME_KEY;
-                case 'F': return END_KEY;
-            }
-        }
+    memcpy(block, &slab->freeLists[index], sizeof(void *));
+    slab->freeLists[index] = block;
+}
 
-        return '\x1b';
+char *editorSlabGrow(char *block, int *capacity, int used, int needed){
+    if(needed <= *capacity){
+        return block;
     }
-    else{
-        return character;
+
+    if(needed > ROW_SLAB_SMALL){
+        int geometric = *capacity + (*capacity / 2);
+
+        if(needed < geometric){
+            needed = geometric;
+        }
     }
-}
 
-void editorProcessKeypress(){
-    static int quitTimes = QUIT_TIMES;
+    int newCapacity;
+    char *grown = editorSlabAlloc(needed, &newCapacity);
 
-    int character = editorReadKey();
+    if(block != NULL){
+        memcpy(grown, block, used);
+        editorSlabFree(block, *capacity);
+    }
 
-    switch(character){
-        case '\r':
-            editorInsertNewLine();
-            break;
+    *capacity = newCapacity;
 
-        case CTRL_KEY('q'):
-            if(editor.dirty && quitTimes > 0){
-                editorSetStatusMessage("Unsaved changes! Press Ctrl-S to save the file or Ctrl-Q %d more times to quit.", quitTimes);
-                quitTimes--;
+    return grown;
+}
 
-                return;
-            }
-            write(STDOUT_FILENO, "\x1b[2J", 4);
-            write(STDOUT_FILENO, "\x1b[H", 3);
-            exit(0);
-            break;
+void editorSlabReset(){
+    struct rowSlab *slab = &editor.slab;
 
-        case CTRL_KEY('s'):
-            editorSave();
-            break;
+    for(int i = 0; i < slab->numChunks; i++){
+        free(slab->chunks[i]);
+    }
 
-        case HOME_KEY:
-            editor.cursorX = 0;
-            break;
+    free(slab->chunks);
 
-        case END_KEY:
-            if(editor.cursorY < editor.numRows){
-                editor.cursorX = editor.row[editor.cursorY].size;
-            }
-            break;
+    memset(slab, 0, sizeof(*slab));
+}
 
-        case BACKSPACE:
-        case CTRL_KEY('h'):
-        case DEL_KEY:
-            if(character == DEL_KEY){
-                editorMoveCursor(ARROW_RIGHT);
-            }
-            editorDelChar();
-            break;
+erow *editorRowAt(int at){
+    if((at < 0) || (at >= editor.numRows)){
+        return NULL;
+    }
 
-        case PAGE_UP:
-        case PAGE_DOWN:
-            {
-                if(character == PAGE_UP){
-                    editor.cursorY = editor.rowOff;
-                }
-                else if(character == PAGE_DOWN){
-                    editor.cursorY = editor.rowOff + editor.screenRows - 1;
+    int start;
+    rowBlock *block = editorFindBlock(at, &start);
 
-                    if(editor.cursorY > editor.numRows){
-                        editor.cursorY = editor.numRows;
-                    }
-                }
+    return &block->rows[at - start];
+}
 
-                int times = editor.screenRows;
+int editorRowIndex(erow *row){
+    rowBlock *block = NULL;
+    int start = editor.lastBlockStart;
 
-                while(times--){
-                    editorMoveCursor(character == PAGE_UP ? ARROW_UP : ARROW_DOWN);
-                }
-            }
-            break;
-        
-        case ARROW_UP:
-        case ARROW_DOWN:
-        case ARROW_LEFT:
-        case ARROW_RIGHT:
-            editorMoveCursor(character);
-            break;
+    if((editor.lastChunk >= 0) && (editor.lastChunk < editor.numChunks) && (editor.lastBlock < editor.chunks[editor.lastChunk]->numBlocks)){
+        block = editor.chunks[editor.lastChunk]->blocks[editor.lastBlock];
+    }
 
-        case CTRL_KEY('l'):
-        case '\x1b':
-            break;
+    if((block == NULL) || (row < block->rows) || (row >= &block->rows[block->count])){
+        start = 0;
 
-        default:
-            editorInsertChar(character);
-            break;
+        for(block = editor.firstBlock; block != NULL; block = block->next){
+            if((row >= block->rows) && (row < &block->rows[block->count])){
+                break;
+            }
+
+            start += block->count;
+        }
     }
 
-    quitTimes = QUIT_TIMES;
+    return start + (row - block->rows);
 }
 
-void editorScroll(){
-    editor.renderX = 0;
-    if(editor.cursorY < editor.numRows){
-        editor.renderX = editorRowcursorXToRx(&editor.row[editor.cursorY], editor.cursorX);
-    }
+erow *editorRowStoreInsert(int at){
+    if(editor.numChunks == 0){
+        rowBlock *block = malloc(sizeof(rowBlock));
+        block->count = 0;
 
-    if(editor.cursorY < editor.rowOff){
-        editor.rowOff = editor.cursorY;
+        editorInsertBlock(0, 0, block);
     }
 
-    if(editor.cursorY >= editor.rowOff + editor.screenRows){
-        editor.rowOff = editor.cursorY - editor.screenRows + 1;
-    }
+    int start;
+    rowBlock *block;
 
-    if(editor.renderX < editor.colOff){
-        editor.colOff = editor.renderX;
+    if(at == editor.numRows){
+        editor.lastChunk = editor.numChunks - 1;
+        editor.lastBlock = editor.chunks[editor.lastChunk]->numBlocks - 1;
+        block = editor.chunks[editor.lastChunk]->blocks[editor.lastBlock];
+        start = at - block->count;
     }
-
-    if(editor.renderX >= editor.colOff + editor.screenColumns){
-        editor.colOff = editor.renderX - editor.screenColumns + 1;
+    else{
+        block = editorFindBlock(at, &start);
     }
-}
 
-void editorDrawRows(struct appendBuffer *ab){
-    for(int i = 0; i < editor.screenRows; i++){
-        int filerow = i + editor.rowOff;
+    if((block->count == ROW_BLOCK_SIZE) && (at == editor.numRows)){
+        block = malloc(sizeof(rowBlock));
+        block->count = 0;
 
-        if(filerow < editor.numRows){
-            int length = editor.row[filerow].rsize - editor.colOff;
+        editorInsertBlock(editor.lastChunk, editor.lastBlock + 1, block);
+        start = at;
+    }
+    else if(block->count == ROW_BLOCK_SIZE){
+        rowBlock *next = malloc(sizeof(rowBlock));
+        int half = ROW_BLOCK_SIZE / 2;
 
-            if(length < 0){
-                length = 0;
-            }
+        next->count = ROW_BLOCK_SIZE - half;
+        memcpy(next->rows, &block->rows[half], sizeof(erow) * next->count);
 
-            if(length > editor.screenColumns){
-                length = editor.screenColumns;
-            }
+        editorBlockTreeAdd(editor.lastChunk, editor.lastBlock, half - ROW_BLOCK_SIZE);
+        block->count = half;
+
+        editorInsertBlock(editor.lastChunk, editor.lastBlock + 1, next);
 
-            abAppend(ab, &editor.row[filerow].render[editor.colOff], length);
+        if(at - start > half){
+            start += half;
+            block = next;
+        }
+        else if(editor.lastBlock > 0){
+            editor.lastBlock--;
+        }
+        else{
+            editor.lastChunk--;
+            editor.lastBlock = editor.chunks[editor.lastChunk]->numBlocks - 1;
         }
+    }
 
-        abAppend(ab, "\x1b[K", 3);
+    int offset = at - start;
 
-        abAppend(ab, "\r\n", 2);
-    }
+    memmove(&block->rows[offset + 1], &block->rows[offset], sizeof(erow) * (block->count - offset));
+    block->count++;
+
+    editorBlockTreeAdd(editor.lastChunk, editor.lastBlock, 1);
+    editor.lastBlockStart = start;
+
+    return &block->rows[offset];
 }
 
-void editorDrawStatusBar(struct appendBuffer *ab){
-    abAppend(ab, "\x1b[7m", 4);
+void editorRowStoreDelete(int at){
+    int start;
+    rowBlock *block = editorFindBlock(at, &start);
+    int c = editor.lastChunk;
+    int b = editor.lastBlock;
+    int offset = at - start;
 
-    int wordCount = editorWordCount();
-    int characterCount = editorCharacterCount();
+    memmove(&block->rows[offset], &block->rows[offset + 1], sizeof(erow) * (block->count - offset - 1));
+    block->count--;
 
-    char status[80], rstatus[80];
-    
-    int length = snprintf(status, sizeof(status), "Line: %d | Column: %d | Words: %d | Characters: %d", editor.cursorY + 1, editor.renderX + 1, wordCount, characterCount);
-    int renderLength = snprintf(rstatus, sizeof(rstatus), "%.20s - %d lines %s", editor.filename ? editor.filename : "[No Name]", editor.numRows, editor.dirty ? "(modified)" : "");
+    editorBlockTreeAdd(c, b, -1);
 
-    if(length > editor.screenColumns){
-        length = editor.screenColumns;
+    if(block->count == 0){
+        editorRemoveBlock(c, b);
     }
+    else if((block->next != NULL) && (block->count + block->next->count <= ROW_BLOCK_SIZE / 2)){
+        rowBlock *next = block->next;
 
-    abAppend(ab, status, length);
+        memcpy(&block->rows[block->count], next->rows, sizeof(erow) * next->count);
+        editorBlockTreeAdd(c, b, next->count);
+        block->count += next->count;
 
-    while(length < editor.screenColumns){
-        if((editor.screenColumns - length) == renderLength){
-            abAppend(ab, rstatus, renderLength);
-            break;
+        if(b + 1 < editor.chunks[c]->numBlocks){
+            editorRemoveBlock(c, b + 1);
         }
         else{
-            abAppend(ab, " ", 1);
-            length++;
+            editorRemoveBlock(c + 1, 0);
         }
     }
-
-    abAppend(ab, "\x1b[m", 3);
-
-    abAppend(ab, "\r\n", 2);
 }
 
-void editorDrawMessageBar(struct appendBuffer *ab){
-    abAppend(ab, "\x1b[K", 3);
+int editorTabSeek(const int *index, int tabs, int field, int value, int sums[2]){
+    int step = 1;
+    while((step << 1) <= tabs){
+        step <<= 1;
+    }
 
-    int msglen = strlen(editor.statusmsg);
+    int pos = 0;
 
-    if(msglen > editor.screenColumns){
-        msglen = editor.screenColumns;
+    sums[0] = 0;
+    sums[1] = 0;
+
+    for(; step > 0; step >>= 1){
+        if((pos + step <= tabs) && (sums[field] + index[(2 * (pos + step - 1)) + field] <= value)){
+            pos += step;
+            sums[0] += index[2 * (pos - 1)];
+            sums[1] += index[(2 * (pos - 1)) + 1];
+        }
     }
 
-    if(msglen && ((time(NULL) - editor.statusmsgTime) < 5)){
-        abAppend(ab, editor.statusmsg, msglen);
+    return pos;
+}
+
+void editorTabPrefix(const int *index, int count, int sums[2]){
+    sums[0] = 0;
+    sums[1] = 0;
+
+    for(int i = count; i > 0; i -= (i & -i)){
+        sums[0] += index[2 * (i - 1)];
+        sums[1] += index[(2 * (i - 1)) + 1];
     }
 }
 
-char *editorPrompt(char *prompt){
-    size_t bufsize = 128;
-    char *buf = malloc(bufsize);
+void editorTabRaw(const int *index, int k, int raw[2]){
+    int i = k + 1;
 
-    size_t buflen = 0;
-    buf[0] = '\0';
+    raw[0] = index[2 * k];
+    raw[1] = index[(2 * k) + 1];
 
-    while(1){
-        editorSetStatusMessage(prompt, buf);
-        editorRefreshScreen();
+    for(int c = i - 1; c > i - (i & -i); c -= (c & -c)){
+        raw[0] -= index[2 * (c - 1)];
+        raw[1] -= index[(2 * (c - 1)) + 1];
+    }
+}
 
-        int character = editorReadKey();
+void editorTabStore(int *index, int tabs, int k, int advance, int rebuild){
+    int width = ((advance + TAB_STOP - 1) / TAB_STOP) * TAB_STOP;
 
-        if((character == DEL_KEY) || (character == CTRL_KEY('h')) || (character == BACKSPACE)){
-            if(buflen != 0){
-                buf[--buflen] = '\0';
-            }
-        }
-        else if(character == '\x1b'){
-            editorSetStatusMessage("");
-            
-            free(buf);
+    if(rebuild){
+        index[2 * k] = advance;
+        index[(2 * k) + 1] = width;
 
-            return NULL;
+        return;
+    }
+
+    int raw[2];
+    editorTabRaw(index, k, raw);
+
+    for(int i = k + 1; i <= tabs; i += (i & -i)){
+        index[2 * (i - 1)] += advance - raw[0];
+        index[(2 * (i - 1)) + 1] += width - raw[1];
+    }
+}
+
+void editorTabUnbuild(int *index, int from, int tabs){
+    for(int k = tabs - 1; k >= from; k--){
+        editorTabRaw(index, k, &index[2 * k]);
+    }
+}
+
+void editorTabBuild(int *index, int from, int tabs){
+    for(int i = from + 1; i <= tabs; i++){
+        for(int c = i - 1; c > i - (i & -i); c -= (c & -c)){
+            index[2 * (i - 1)] += index[2 * (c - 1)];
+            index[(2 * (i - 1)) + 1] += index[(2 * (c - 1)) + 1];
         }
-        else if(character == '\r'){
-            if(buflen != 0){
-                editorSetStatusMessage("");
-                
-                return buf;
-            }
+    }
+}
+
+int editorRowcursorXToRx(erow *row, int cursorX){
+    int sums[2];
+
+    editorTabSeek(row->tabIndex, row->tabs, 0, cursorX, sums);
+
+    return cursorX + sums[1] - sums[0];
+}
+
+int editorRowRxToCursorX(erow *row, int renderX){
+    int sums[2];
+    int low = editorTabSeek(row->tabIndex, row->tabs, 1, renderX, sums);
+
+    int cursorX = sums[0];
+    int baseX = sums[1];
+
+    if(low < row->tabs){
+        int raw[2];
+        editorTabRaw(row->tabIndex, low, raw);
+
+        if(renderX - baseX >= raw[0] - 1){
+            return cursorX + raw[0] - 1;
         }
-        else if((!iscntrl(character)) && (character < 128)){
-            if(buflen == (bufsize - 1)){
-                bufsize *= 2;
-                buf = realloc(buf, bufsize);
-            }
+    }
 
-            buf[buflen++] = character;
-            buf[buflen] = '\0';
+    cursorX += renderX - baseX;
+
+    return (cursorX > row->size) ? row->size : cursorX;
+}
+
+int editorTabIndexCapacity(int tabs){
+    int capacity;
+
+    editorSlabClass(sizeof(int) * 2 * tabs, &capacity);
+
+    return capacity;
+}
+
+void editorRowIndexTabs(erow *row){
+    if(row->tabIndex != NULL){
+        editorSlabFree((char *)row->tabIndex, editorTabIndexCapacity(row->tabs));
+    }
+
+    row->tabIndex = NULL;
+    row->tabs = 0;
+
+    editorRowSpliceTabs(row, 0, 0, row->chars, row->size);
+}
+
+void editorRowSpliceTabs(erow *row, int at, int removed, const char *s, int inserted){
+    int sums[2];
+    int first = editorTabSeek(row->tabIndex, row->tabs, 0, at, sums);
+    int previous = sums[0] - 1;
+    int after = editorTabSeek(row->tabIndex, row->tabs, 0, at + removed, sums);
+    int next = -1;
+
+    if(after < row->tabs){
+        int raw[2];
+        editorTabRaw(row->tabIndex, after, raw);
+
+        next = sums[0] + raw[0] - 1 + inserted - removed;
+    }
+
+    int added = 0;
+    const char *end = s + inserted;
+
+    for(const char *tab = s; (inserted > 0) && ((tab = memchr(tab, '\t', end - tab)) != NULL); tab++){
+        added++;
+    }
+
+    int tabs = row->tabs - (after - first) + added;
+    int *index = row->tabIndex;
+    int rebuild = (added != after - first);
+
+    if(rebuild){
+        editorTabUnbuild(row->tabIndex, after, row->tabs);
+    }
+
+    if((tabs == 0) || (index == NULL) || (editorTabIndexCapacity(tabs) != editorTabIndexCapacity(row->tabs))){
+        int capacity;
+
+        index = (tabs > 0) ? (int *)editorSlabAlloc(sizeof(int) * 2 * tabs, &capacity) : NULL;
+
+        if((index != NULL) && (row->tabIndex != NULL)){
+            memcpy(index, row->tabIndex, sizeof(int) * 2 * first);
         }
     }
+
+    if(rebuild && (index != NULL) && (after < row->tabs)){
+        memmove(&index[2 * (first + added)], &row->tabIndex[2 * after], sizeof(int) * 2 * (row->tabs - after));
+    }
+
+    if(index != row->tabIndex){
+        editorSlabFree((char *)row->tabIndex, editorTabIndexCapacity(row->tabs));
+    }
+
+    int k = first;
+
+    for(const char *tab = s; (inserted > 0) && ((tab = memchr(tab, '\t', end - tab)) != NULL); tab++){
+        int position = at + (tab - s);
+
+        editorTabStore(index, tabs, k, position - previous, rebuild);
+        previous = position;
+        k++;
+    }
+
+    if(next >= 0){
+        editorTabStore(index, tabs, k, next - previous, rebuild);
+    }
+
+    if(rebuild){
+        editorTabBuild(index, first, tabs);
+    }
+
+    editorTabPrefix(index, tabs, sums);
+
+    row->tabIndex = index;
+    row->tabs = tabs;
+    row->rsize = sums[1] + (row->size - sums[0]);
 }
 
-void editorSetStatusMessage(const char *fmt, ...){
-    va_list ap;
+void editorUpdateRow(erow *row){
+    row->renderSlot = -1;
+    row->damaged = 1;
 
-    va_start(ap, fmt);
-    vsnprintf(editor.statusmsg, sizeof(editor.statusmsg), fmt, ap);
-    va_end(ap);
+    if(row->lineState != 0){
+        editorSyntaxDamage(editorRowIndex(row));
+    }
+}
 
-    editor.statusmsgTime = time(NULL);
+void editorGapClose(){
+    struct rowGap *gap = &editor.gap;
+
+    if(gap->chars == NULL){
+        return;
+    }
+
+    memmove(&gap->chars[gap->start], &gap->chars[gap->start + gap->length], gap->tail + 1);
+
+    gap->chars = NULL;
 }
 
-void editorRefreshScreen(){
-    editorScroll();
+void editorRowMoveGap(erow *row, int at, int needed){
+    struct rowGap *gap = &editor.gap;
 
-    struct appendBuffer ab = ABUF_INIT;
+    if(gap->chars != row->chars){
+        editorGapClose();
+
+        gap->chars = row->chars;
+        gap->start = row->size;
+        gap->length = 0;
+        gap->tail = 0;
+    }
 
-    abAppend(&ab, "\x1b[?25l", 6);
-    abAppend(&ab, "\x1b[H", 3);
+    if(at < gap->start){
+        memmove(&gap->chars[at + gap->length], &gap->chars[at], gap->start - at);
+    }
+    else if(at > gap->start){
+        memmove(&gap->chars[gap->start], &gap->chars[gap->start + gap->length], at - gap->start);
+    }
 
-    editorDrawRows(&ab);
-    editorDrawStatusBar(&ab);
-    editorDrawMessageBar(&ab);
+    gap->start = at;
+    gap->tail = row->size - at;
 
-    char buf[32];
-    snprintf(buf, sizeof(buf), "\x1b[%d;%dH", (editor.cursorY - editor.rowOff) + 1, (editor.renderX - editor.colOff) + 1);
-    abAppend(&ab, buf, strlen(buf));
+    if(gap->length >= needed){
+        return;
+    }
 
-    abAppend(&ab, "\x1b[?25h", 6);
+    int used = row->size + gap->length + 1;
 
-    write(STDOUT_FILENO, ab.buffer, ab.length);
+    row->chars = editorSlabGrow(row->chars, &row->capacity, used, row->size + needed + 1);
 
-    abFree(&ab);
+    memmove(&row->chars[row->capacity - gap->tail - 1], &row->chars[gap->start + gap->length], gap->tail + 1);
+
+    gap->chars = row->chars;
+    gap->length = row->capacity - row->size - 1;
 }
 
-void editorMoveCursor(int key){
-    erow *row = (editor.cursorY >= editor.numRows) ? NULL : &editor.row[editor.cursorY];
+char *editorRowChars(erow *row){
+    if(row->chars == editor.gap.chars){
+        editorGapClose();
+    }
 
-    switch(key){
-        case ARROW_LEFT:
-            if(editor.cursorX != 0){
-                editor.cursorX--;
-            }
-            else if(editor.cursorY > 0){
-                editor.cursorY--;
-                editor.cursorX = editor.row[editor.cursorY].size;
-            }
-            break;
-        case ARROW_RIGHT:
-            if(row && editor.cursorX < row->size){
-                editor.cursorX++;
-            }
-            else if(row && editor.cursorX == row->size){
-                editor.cursorY++;
-                editor.cursorX = 0;
+    return row->chars;
+}
+
+char *editorRowRender(erow *row, int start, int width, int *length){
+    int gapAt = row->size;
+    int gapLength = 0;
+
+    if(row->chars == editor.gap.chars){
+        gapAt = editor.gap.start;
+        gapLength = editor.gap.length;
+    }
+
+    if((row->tabs == 0) && ((start >= gapAt) || (start + width <= gapAt))){
+        *length = row->size - start;
+
+        if(*length < 0){
+            *length = 0;
+        }
+
+        if(*length > width){
+            *length = width;
+        }
+
+        if(*length == 0){
+            return row->chars;
+        }
+
+        return &row->chars[start + ((start >= gapAt) ? gapLength : 0)];
+    }
+
+    struct renderCache *cache = &editor.renderCache;
+    struct renderEntry *entry;
+
+    cache->clock++;
+
+    if(row->renderSlot >= 0){
+        entry = &cache->entries[row->renderSlot];
+
+        if((entry->owner == row->chars) && (entry->start == start) && (entry->length >= width || (start + entry->length >= row->rsize))){
+            entry->lastUsed = cache->clock;
+            *length = (entry->length < width) ? entry->length : width;
+
+            return entry->buffer;
+        }
+    }
+
+    int slot = 0;
+
+    for(int i = 1; i < RENDER_CACHE_SIZE; i++){
+        if(cache->entries[i].lastUsed < cache->entries[slot].lastUsed){
+            slot = i;
+        }
+    }
+
+    entry = &cache->entries[slot];
+
+    if(entry->capacity < width + 1){
+        entry->capacity = width + 1;
+        entry->buffer = realloc(entry->buffer, entry->capacity);
+    }
+
+    int cursorX = editorRowRxToCursorX(row, start);
+    int renderX = editorRowcursorXToRx(row, cursorX);
+    int idx = 0;
+
+    while((cursorX < row->size) && (renderX < start + width)){
+        char character = row->chars[cursorX + ((cursorX >= gapAt) ? gapLength : 0)];
+
+        if(character == '\t'){
+            int next = renderX + TAB_STOP - (renderX % TAB_STOP);
+
+            for(; renderX < next; renderX++){
+                if((renderX >= start) && (renderX < start + width)){
+                    entry->buffer[idx++] = ' ';
+                }
             }
-            break;
-        case ARROW_UP:
-            if(editor.cursorY != 0){
-                editor.cursorY--;
+        }
+        else{
+            if(renderX >= start){
+                entry->buffer[idx++] = character;
             }
-            break;
-        case ARROW_DOWN:
-            if(editor.cursorY < editor.numRows){
-                editor.cursorY++;
+
+            renderX++;
+        }
+
+        cursorX++;
+    }
+
+    entry->buffer[idx] = '\0';
+
+    entry->owner = row->chars;
+    entry->start = start;
+    entry->length = idx;
+    entry->lastUsed = cache->clock;
+    row->renderSlot = slot;
+
+    *length = idx;
+
+    return entry->buffer;
+}
+
+void editorSyntaxSelect(){
+    struct syntaxState *syntax = &editor.syntax;
+    char *extension = (editor.filename != NULL) ? strrchr(editor.filename, '.') : NULL;
+
+    syntax->definition = NULL;
+
+    for(size_t i = 0; (extension != NULL) && (i < sizeof(syntaxDefinitions) / sizeof(syntaxDefinitions[0])); i++){
+        for(int j = 0; syntaxDefinitions[i].extensions[j] != NULL; j++){
+            if(strcmp(extension, syntaxDefinitions[i].extensions[j]) == 0){
+                syntax->definition = &syntaxDefinitions[i];
             }
-            break;
+        }
     }
 
-    row = (editor.cursorY >= editor.numRows) ? NULL : &editor.row[editor.cursorY];
-    
-    int rowlen = row ? row->size : 0;
+    editorSyntaxReset();
+    editorDamageRows(0);
+}
 
-    if(editor.cursorX > rowlen){
-        editor.cursorX = rowlen;
+void editorSyntaxReset(){
+    editor.syntax.computed = 0;
+    editor.syntax.dirtyFrom = INT_MAX;
+    editor.syntax.dirtyTo = 0;
+}
+
+void editorSyntaxDamage(int at){
+    struct syntaxState *syntax = &editor.syntax;
+
+    if((syntax->definition == NULL) || !syntax->definition->multiline || (at >= syntax->computed)){
+        return;
+    }
+
+    if(at < syntax->dirtyFrom){
+        syntax->dirtyFrom = at;
+    }
+
+    if(at + 1 > syntax->dirtyTo){
+        syntax->dirtyTo = at + 1;
     }
 }
 
-void abAppend(struct appendBuffer *ab, const char *s, int length){
-    char *new = realloc(ab->buffer, ab->length + length);
+void editorSyntaxShift(int at, int delta){
+    struct syntaxState *syntax = &editor.syntax;
 
-    if(new == NULL){
+    if((syntax->definition == NULL) || !syntax->definition->multiline){
         return;
     }
 
-    memcpy(&new[ab->length], s, length);
-    
-    ab->buffer = new;
-    ab->length += length;
+    if(at < syntax->computed){
+        syntax->computed += delta;
+    }
+
+    if(syntax->dirtyFrom != INT_MAX){
+        if(at < syntax->dirtyFrom){
+            syntax->dirtyFrom += delta;
+        }
+
+        if(at < syntax->dirtyTo){
+            syntax->dirtyTo += delta;
+        }
+    }
+
+    editorSyntaxDamage(at);
 }
 
-void abFree(struct appendBuffer *ab){
-    free(ab->buffer);
+const char *editorSyntaxText(erow *row, int from, int to){
+    struct rowGap *gap = &editor.gap;
+    struct syntaxState *syntax = &editor.syntax;
+
+    if((row->chars != gap->chars) || (gap->start >= to)){
+        return &row->chars[from];
+    }
+
+    if(gap->start <= from){
+        return &row->chars[from + gap->length];
+    }
+
+    if(syntax->textCapacity < to - from + 1){
+        int capacity = syntax->textCapacity ? syntax->textCapacity : 64;
+
+        while(capacity < to - from + 1){
+            capacity *= 2;
+        }
+
+        syntax->textCapacity = capacity;
+        syntax->text = realloc(syntax->text, capacity);
+    }
+
+    memcpy(syntax->text, &row->chars[from], gap->start - from);
+    memcpy(&syntax->text[gap->start - from], &row->chars[gap->start + gap->length], to - gap->start);
+
+    return syntax->text;
 }
 
-void die(const char *s){
-    write(STDOUT_FILENO, "\x1b[2J", 4);
-    write(STDOUT_FILENO, "\x1b[H", 3);
+void editorSyntaxUpdate(int to){
+    struct syntaxState *syntax = &editor.syntax;
+    const struct syntaxDefinition *definition = syntax->definition;
 
-    perror(s);
-    exit(1);
-}
\ No newline at end of file
+    if((definition == NULL) || !definition->multiline){
+        return;
+    }
+
+    if(to > editor.numRows){
+        to = editor.numRows;
+    }
+
+    int r = (syntax->dirtyFrom < syntax->computed) ? syntax->dirtyFrom : syntax->computed;
+    int state = (r == 0) ? LINE_NORMAL : editorRowAt(r - 1)->lineState - 1;
+
+    while(r < to){
+        erow *row = editorRowAt(r);
+        int old = row->lineState;
+
+        state = definition->highlight(definition, editorSyntaxText(row, 0, row->size), row->size, state, NULL);
+        row->lineState = state + 1;
+        r++;
+
+        if((old != row->lineState) && (r < editor.numRows)){
+            editorRowAt(r)->damaged = 1;
+        }
+
+        if(r >= syntax->computed){
+            syntax->computed = r;
+            syntax->dirtyFrom = INT_MAX;
+            syntax->dirtyTo = 0;
+        }
+        else if((old == row->lineState) && (r >= syntax->dirtyTo)){
+            r = syntax->computed;
+            state = editorRowAt(r - 1)->lineState - 1;
+            syntax->dirtyFrom = INT_MAX;
+            syntax->dirtyTo = 0;
+        }
+        else{
+            syntax->dirtyFrom = r;
+
+            if(syntax->dirtyTo <= r){
+                syntax->dirtyTo = r + 1;
+            }
+        }
+    }
+}
+
+unsigned char *editorSyntaxHighlight(erow *row, int at, int start, int limit, int *from){
+    struct syntaxState *syntax = &editor.syntax;
+    const struct syntaxDefinition *definition = syntax->definition;
+    int state = LINE_NORMAL;
+
+    if(limit > row->size){
+        limit = row->size;
+    }
+
+    *from = 0;
+
+    if(definition->multiline && (at > 0)){
+        editorSyntaxUpdate(at);
+        state = editorRowAt(at - 1)->lineState - 1;
+    }
+    else if(!definition->multiline && (start > SYNTAX_RESYNC_BYTES)){
+        *from = start - SYNTAX_RESYNC_BYTES;
+    }
+
+    if(syntax->highlightCapacity < limit - *from + 1){
+        int capacity = syntax->highlightCapacity ? syntax->highlightCapacity : 64;
+
+        while(capacity < limit - *from + 1){
+            capacity *= 2;
+        }
+
+        syntax->highlightCapacity = capacity;
+        syntax->highlight = realloc(syntax->highlight, capacity);
+    }
+
+    const char *text = editorSyntaxText(row, *from, limit);
+    int skip = 0;
+
+    if(*from > 0){
+        while((skip < start - *from) && !isspace((unsigned char)text[skip]) && (text[skip] != ',')){
+            skip++;
+        }
+
+        skip = (skip < start - *from) ? (skip + 1) : 0;
+
+        memset(syntax->highlight, HL_NORMAL, skip);
+    }
+
+    definition->highlight(definition, &text[skip], limit - *from - skip, state, &syntax->highlight[skip]);
+
+    return syntax->highlight;
+}
+
+void editorSyntaxMark(unsigned char *hl, int from, int to, int type){
+    if((hl != NULL) && (to > from)){
+        memset(&hl[from], type, to - from);
+    }
+}
+
+int editorSyntaxString(const char *s, int size, int at){
+    char quote = s[at++];
+
+    while(at < size){
+        if(s[at] == '\\'){
+            at += 2;
+        }
+        else if(s[at++] == quote){
+            return at;
+        }
+    }
+
+    return size;
+}
+
+int editorSyntaxKeyword(const struct syntaxDefinition *syntax, const char *word, int length){
+    for(int i = 0; syntax->keywords[i] != NULL; i++){
+        const char *keyword = syntax->keywords[i];
+
+        if((keyword[0] != word[0]) || (strncmp(keyword, word, length) != 0)){
+            continue;
+        }
+
+        if(keyword[length] == '\0'){
+            return HL_KEYWORD;
+        }
+
+        if((keyword[length] == '|') && (keyword[length + 1] == '\0')){
+            return HL_TYPE;
+        }
+    }
+
+    return HL_NORMAL;
+}
+
+int editorHighlightC(const struct syntaxDefinition *syntax, const char *s, int size, int state, unsigned char *hl){
+    int i = 0;
+    int blank = 1;
+
+    if(state == LINE_COMMENT){
+        char *end = memmem(s, size, "*/", 2);
+
+        if(end == NULL){
+            editorSyntaxMark(hl, 0, size, HL_COMMENT);
+
+            return LINE_COMMENT;
+        }
+
+        i = end - s + 2;
+        editorSyntaxMark(hl, 0, i, HL_COMMENT);
+        blank = 0;
+    }
+
+    while(i < size){
+        int start = i;
+        char c = s[i];
+
+        if((c == '/') && (i + 1 < size) && (s[i + 1] == '/')){
+            editorSyntaxMark(hl, i, size, HL_COMMENT);
+
+            return LINE_NORMAL;
+        }
+
+        if((c == '/') && (i + 1 < size) && (s[i + 1] == '*')){
+            char *end = memmem(&s[i + 2], size - i - 2, "*/", 2);
+
+            if(end == NULL){
+                editorSyntaxMark(hl, i, size, HL_COMMENT);
+
+                return LINE_COMMENT;
+            }
+
+            i = end - s + 2;
+            editorSyntaxMark(hl, start, i, HL_COMMENT);
+        }
+        else if((c == '"') || (c == '\'')){
+            i = editorSyntaxString(s, size, i);
+            editorSyntaxMark(hl, start, i, HL_STRING);
+        }
+        else if((c == '#') && blank){
+            for(i++; (i < size) && isspace((unsigned char)s[i]); i++);
+            for(; (i < size) && isalpha((unsigned char)s[i]); i++);
+
+            editorSyntaxMark(hl, start, i, HL_PREPROCESSOR);
+        }
+        else if(isdigit((unsigned char)c)){
+            for(i++; (i < size) && (isalnum((unsigned char)s[i]) || (s[i] == '.') || (s[i] == '_')); i++);
+
+            editorSyntaxMark(hl, start, i, HL_NUMBER);
+        }
+        else if(isalpha((unsigned char)c) || (c == '_')){
+            for(i++; (i < size) && (isalnum((unsigned char)s[i]) || (s[i] == '_')); i++);
+
+            if(hl != NULL){
+                editorSyntaxMark(hl, start, i, editorSyntaxKeyword(syntax, &s[start], i - start));
+            }
+        }
+        else{
+            editorSyntaxMark(hl, i, i + 1, HL_NORMAL);
+            i++;
+        }
+
+        if(!isspace((unsigned char)c)){
+            blank = 0;
+        }
+    }
+
+    return LINE_NORMAL;
+}
+
+int editorHighlightJson(const struct syntaxDefinition *syntax, const char *s, int size, int state, unsigned char *hl){
+    int i = 0;
+
+    while(i < size){
+        int start = i;
+        char c = s[i];
+
+        if(c == '"'){
+            i = editorSyntaxString(s, size, i);
+
+            int next = i;
+
+            for(; (next < size) && isspace((unsigned char)s[next]); next++);
+
+            editorSyntaxMark(hl, start, i, ((next < size) && (s[next] == ':')) ? HL_KEY : HL_STRING);
+        }
+        else if(isdigit((unsigned char)c) || ((c == '-') && (i + 1 < size) && isdigit((unsigned char)s[i + 1]))){
+            for(i++; (i < size) && (isalnum((unsigned char)s[i]) || (s[i] == '.') || (s[i] == '+') || (s[i] == '-')); i++);
+
+            editorSyntaxMark(hl, start, i, HL_NUMBER);
+        }
+        else if(isalpha((unsigned char)c)){
+            for(i++; (i < size) && isalpha((unsigned char)s[i]); i++);
+
+            editorSyntaxMark(hl, start, i, editorSyntaxKeyword(syntax, &s[start], i - start));
+        }
+        else{
+            editorSyntaxMark(hl, i, i + 1, HL_NORMAL);
+            i++;
+        }
+    }
+
+    return state;
+}
+
+int editorHighlightYaml(const struct syntaxDefinition *syntax, const char *s, int size, int state, unsigned char *hl){
+    int i = 0;
+
+    if((size >= 3) && ((memcmp(s, "---", 3) == 0) || (memcmp(s, "...", 3) == 0)) && ((size == 3) || isspace((unsigned char)s[3]))){
+        editorSyntaxMark(hl, 0, 3, HL_PREPROCESSOR);
+        i = 3;
+    }
+
+    for(; (i < size) && (isspace((unsigned char)s[i]) || ((s[i] == '-') && ((i + 1 == size) || isspace((unsigned char)s[i + 1])))); i++){
+        editorSyntaxMark(hl, i, i + 1, HL_NORMAL);
+    }
+
+    int key = i;
+
+    for(; (key < size) && (s[key] != '"') && (s[key] != '\'') && (s[key] != '#'); key++){
+        if((s[key] == ':') && ((key + 1 == size) || isspace((unsigned char)s[key + 1]))){
+            editorSyntaxMark(hl, i, key, HL_KEY);
+            i = key;
+
+            break;
+        }
+    }
+
+    while(i < size){
+        int start = i;
+        char c = s[i];
+
+        if((c == '#') && ((i == 0) || isspace((unsigned char)s[i - 1]))){
+            editorSyntaxMark(hl, i, size, HL_COMMENT);
+
+            return state;
+        }
+
+        if((c == '"') || (c == '\'')){
+            i = editorSyntaxString(s, size, i);
+
+            editorSyntaxMark(hl, start, i, ((i < size) && (s[i] == ':')) ? HL_KEY : HL_STRING);
+        }
+        else if(isspace((unsigned char)c) || (c == ':') || (c == ',') || (c == '[') || (c == ']') || (c == '{') || (c == '}')){
+            editorSyntaxMark(hl, i, i + 1, HL_NORMAL);
+            i++;
+        }
+        else{
+            for(i++; (i < size) && !isspace((unsigned char)s[i]) && (s[i] != ',') && (s[i] != ']') && (s[i] != '}'); i++);
+
+            int type = HL_NORMAL;
+
+            if((c == '&') || (c == '*') || (c == '!')){
+                type = HL_TYPE;
+            }
+            else if(isdigit((unsigned char)c) || (((c == '-') || (c == '+') || (c == '.')) && (i - start > 1) && isdigit((unsigned char)s[start + 1]))){
+                type = HL_NUMBER;
+            }
+            else if(hl != NULL){
+                type = editorSyntaxKeyword(syntax, &s[start], i - start);
+            }
+
+            editorSyntaxMark(hl, start, i, type);
+        }
+    }
+
+    return state;
+}
+
+void editorInsertRow(int at, char *s, size_t length){
+    if((at < 0) || (at > editor.numRows)){
+        return;
+    }
+
+    editorJournalEdit(UNDO_INSERT_ROWS, at, 0, s, length, 0);
+
+    erow *row = editorRowStoreInsert(at);
+
+    row->size = length;
+    row->chars = editorSlabAlloc(length + 1, &row->capacity);
+    row->tabIndex = NULL;
+    row->tabs = 0;
+    row->mapped = 0;
+    row->frozen = 0;
+    row->lineState = 0;
+    
+    memcpy(row->chars, s, length);
+    row->chars[length] = '\0';
+
+    row->words = 0;
+    row->characters = 0;
+
+    int words, characters;
+    editorCountString(row->chars, row->size, &words, &characters);
+    editorRowSetCounts(row, words, characters);
+
+    editorRowIndexTabs(row);
+    editorUpdateRow(row);
+
+    editorDamageRows(at);
+    editorSyntaxShift(at, 1);
+
+    editor.numRows++;
+    editor.dirty++;
+}
+
+void editorAppendMappedRow(char *s, size_t length, int words, int characters, int tabs){
+    erow *row = editorRowStoreInsert(editor.numRows);
+
+    row->size = length;
+    row->chars = s;
+    row->capacity = 0;
+    row->tabIndex = NULL;
+    row->tabs = 0;
+    row->mapped = 1;
+    row->frozen = 0;
+    row->lineState = 0;
+
+    row->words = 0;
+    row->characters = 0;
+
+    editorRowSetCounts(row, words, characters);
+
+    if(tabs > 0){
+        editorRowIndexTabs(row);
+    }
+    else{
+        row->rsize = row->size;
+    }
+
+    editorUpdateRow(row);
+
+    editor.numRows++;
+}
+
+void editorRowOwn(erow *row){
+    if(!row->mapped && !row->frozen){
+        return;
+    }
+
+    int capacity;
+    char *chars = editorSlabAlloc(row->size + 1, &capacity);
+
+    memcpy(chars, row->chars, row->size);
+    chars[row->size] = '\0';
+
+    if(row->frozen){
+        editorRetireChars(row->chars, row->capacity);
+    }
+
+    row->chars = chars;
+    row->capacity = capacity;
+    row->mapped = 0;
+    row->frozen = 0;
+}
+
+void editorFreeRow(erow *row){
+    if(row->tabIndex != NULL){
+        editorSlabFree((char *)row->tabIndex, editorTabIndexCapacity(row->tabs));
+    }
+
+    if(row->chars == editor.gap.chars){
+        editor.gap.chars = NULL;
+    }
+
+    if(row->frozen){
+        editorRetireChars(row->chars, row->capacity);
+    }
+    else if(!row->mapped){
+        editorSlabFree(row->chars, row->capacity);
+    }
+}
+
+void editorFreeRows(){
+    for(rowBlock *block = editor.firstBlock; block != NULL;){
+        rowBlock *next = block->next;
+
+        for(int i = 0; i < block->count; i++){
+            erow *row = &block->rows[i];
+            int capacity;
+
+            if((row->tabIndex != NULL) && (editorSlabClass(editorTabIndexCapacity(row->tabs), &capacity) == -1)){
+                editorSlabFree((char *)row->tabIndex, editorTabIndexCapacity(row->tabs));
+            }
+
+            if(!row->mapped && (editorSlabClass(row->capacity, &capacity) == -1)){
+                editorSlabFree(row->chars, row->capacity);
+            }
+        }
+
+        free(block);
+        block = next;
+    }
+
+    for(int c = 0; c < editor.numChunks; c++){
+        free(editor.chunks[c]);
+    }
+
+    editorSlabReset();
+
+    editor.gap.chars = NULL;
+
+    editor.numChunks = 0;
+    editor.firstBlock = NULL;
+    editor.numBlocks = 0;
+    editor.numRows = 0;
+    editor.wordCount = 0;
+    editor.characterCount = 0;
+    editor.lastChunk = -1;
+
+    editorDamageRows(0);
+    editorSyntaxReset();
+}
+
+void editorDelRow(int at){
+    if((at < 0) || (at >= editor.numRows)){
+        return;
+    }
+
+    erow *row = editorRowAt(at);
+
+    if(editorJournaling()){
+        editorJournalEdit(UNDO_DELETE_ROWS, at, 0, editorRowChars(row), row->size, 0);
+    }
+
+    editorRowSetCounts(row, 0, 0);
+    editorFreeRow(row);
+    editorRowStoreDelete(at);
+
+    editorDamageRows(at);
+    editorSyntaxShift(at, -1);
+
+    editor.numRows--;
+    editor.dirty++;
+}
+
+void editorRowInsertChar(erow *row, int at, int character){
+    if((at < 0) || (at > row->size)){
+        at = row->size;
+    }
+
+    if(editorJournaling()){
+        char typed = character;
+
+        editorJournalEdit(UNDO_INSERT_TEXT, editorRowIndex(row), at, &typed, 1, 1);
+    }
+
+    editorRowOwn(row);
+    editorRowMoveGap(row, at, 1);
+
+    struct rowGap *gap = &editor.gap;
+
+    int prev = (at > 0) ? row->chars[at - 1] : ' ';
+    int next = (at < row->size) ? row->chars[at + gap->length] : ' ';
+    int words = row->words + editorWordStarts(prev, character) + editorWordStarts(character, next) - editorWordStarts(prev, next);
+
+    editorRowSetCounts(row, words, row->characters + editorIsWordChar(character));
+
+    row->chars[at] = character;
+    row->size++;
+
+    gap->start++;
+    gap->length--;
+
+    editorRowSpliceTabs(row, at, 0, &row->chars[at], 1);
+    editorUpdateRow(row);
+
+    editor.dirty++;
+}
+
+void editorRowInsertString(erow *row, int at, char *s, size_t length){
+    if((at < 0) || (at > row->size)){
+        at = row->size;
+    }
+
+    if(length == 0){
+        return;
+    }
+
+    if(editorJournaling()){
+        editorJournalEdit(UNDO_INSERT_TEXT, editorRowIndex(row), at, s, length, 0);
+    }
+
+    editorRowOwn(row);
+    editorRowMoveGap(row, at, length);
+
+    struct rowGap *gap = &editor.gap;
+
+    int prev = (at > 0) ? row->chars[at - 1] : ' ';
+    int next = (at < row->size) ? row->chars[at + gap->length] : ' ';
+    int words, characters;
+
+    editorCountString(s, length, &words, &characters);
+
+    words += row->words;
+    words -= editorIsWordChar(s[0]) && editorIsWordChar(prev);
+    words += editorWordStarts(s[length - 1], next) - editorWordStarts(prev, next);
+
+    editorRowSetCounts(row, words, row->characters + characters);
+
+    memcpy(&row->chars[at], s, length);
+
+    row->size += length;
+
+    gap->start += length;
+    gap->length -= length;
+
+    editorRowSpliceTabs(row, at, 0, s, length);
+    editorUpdateRow(row);
+
+    editor.dirty++;
+}
+
+void editorRowAppendString(erow *row, char *s, size_t length){
+    if(editorJournaling()){
+        editorJournalEdit(UNDO_INSERT_TEXT, editorRowIndex(row), row->size, s, length, 0);
+    }
+
+    editorRowOwn(row);
+    editorRowChars(row);
+
+    int words, characters;
+    editorCountString(s, length, &words, &characters);
+
+    if((row->size > 0) && (length > 0)){
+        words -= editorIsWordChar(row->chars[row->size - 1]) && editorIsWordChar(s[0]);
+    }
+
+    editorRowSetCounts(row, row->words + words, row->characters + characters);
+
+    row->chars = editorSlabGrow(row->chars, &row->capacity, row->size + 1, row->size + length + 1);
+
+    memcpy(&row->chars[row->size], s, length);
+
+    row->size += length;
+    row->chars[row->size] = '\0';
+
+    editorRowSpliceTabs(row, row->size - length, 0, s, length);
+    editorUpdateRow(row);
+
+    editor.dirty++;
+}
+
+void editorRowTruncate(erow *row, int at){
+    if((at < 0) || (at >= row->size)){
+        return;
+    }
+
+    if(editorJournaling()){
+        editorJournalEdit(UNDO_DELETE_TEXT, editorRowIndex(row), at, &editorRowChars(row)[at], row->size - at, 0);
+    }
+
+    editorRowOwn(row);
+    editorRowChars(row);
+
+    int words, characters;
+    editorCountString(&row->chars[at], row->size - at, &words, &characters);
+
+    int split = (at > 0) && editorIsWordChar(row->chars[at - 1]) && editorIsWordChar(row->chars[at]);
+
+    editorRowSetCounts(row, row->words - words + split, row->characters - characters);
+
+    int removed = row->size - at;
+
+    row->size = at;
+    row->chars[row->size] = '\0';
+
+    editorRowSpliceTabs(row, at, removed, NULL, 0);
+    editorUpdateRow(row);
+
+    editor.dirty++;
+}
+
+void editorRowDelChar(erow *row, int at){
+    if((at < 0) || (at >= row->size)){
+        return;
+    }
+
+    editorRowOwn(row);
+    editorRowMoveGap(row, at, 0);
+
+    struct rowGap *gap = &editor.gap;
+
+    char character = row->chars[at + gap->length];
+    int prev = (at > 0) ? row->chars[at - 1] : ' ';
+
+    if(editorJournaling()){
+        editorJournalEdit(UNDO_DELETE_TEXT, editorRowIndex(row), at, &character, 1, 1);
+    }
+
+    int next = (at + 1 < row->size) ? row->chars[at + gap->length + 1] : ' ';
+    int words = row->words - editorWordStarts(prev, character) - editorWordStarts(character, next) + editorWordStarts(prev, next);
+
+    editorRowSetCounts(row, words, row->characters - editorIsWordChar(character));
+
+    row->size--;
+
+    gap->length++;
+    gap->tail--;
+
+    editorRowSpliceTabs(row, at, 1, NULL, 0);
+    editorUpdateRow(row);
+
+    editor.dirty++;
+}
+
+void editorInsertChar(int character){
+    if(editor.cursorY == editor.numRows){
+        editorInsertRow(editor.numRows, "", 0);
+    }
+
+    editorRowInsertChar(editorRowAt(editor.cursorY), editor.cursorX, character);
+    editor.cursorX++;
+}
+
+void editorInsertNewLine(){
+    if(editor.cursorX == 0){
+        editorInsertRow(editor.cursorY, "", 0);
+    }
+    else{
+        erow *row = editorRowAt(editor.cursorY);
+
+        editorInsertRow(editor.cursorY + 1, &editorRowChars(row)[editor.cursorX], row->size - editor.cursorX);
+
+        row = editorRowAt(editor.cursorY);
+        editorRowTruncate(row, editor.cursorX);
+    }
+
+    editor.cursorY++;
+    editor.cursorX = 0;
+}
+
+void editorDelChar(){
+    if(editor.cursorY == editor.numRows){
+        return;
+    }
+
+    if((editor.cursorX == 0) && (editor.cursorY == 0)){
+        return;
+    }
+
+    erow *row = editorRowAt(editor.cursorY);
+
+    if(editor.cursorX > 0){
+        editorRowDelChar(row, editor.cursorX - 1);
+        editor.cursorX--;
+    }
+    else{
+        erow *prev = editorRowAt(editor.cursorY - 1);
+
+        editor.cursorX = prev->size;
+
+        editorRowAppendString(prev, editorRowChars(row), row->size);
+        editorDelRow(editor.cursorY);
+
+        editor.cursorY--;
+    }
+}
+
+void editorInsertText(char *s, size_t length){
+    size_t normalized = 0;
+
+    for(size_t i = 0; i < length; i++){
+        if(s[i] == '\r'){
+            if((i + 1 < length) && (s[i + 1] == '\n')){
+                continue;
+            }
+
+            s[normalized++] = '\n';
+        }
+        else{
+            s[normalized++] = s[i];
+        }
+    }
+
+    length = normalized;
+
+    if(length == 0){
+        return;
+    }
+
+    if(editor.cursorY == editor.numRows){
+        editorInsertRow(editor.numRows, "", 0);
+    }
+
+    char *newline = memchr(s, '\n', length);
+
+    if(newline == NULL){
+        editorRowInsertString(editorRowAt(editor.cursorY), editor.cursorX, s, length);
+        editor.cursorX += length;
+
+        return;
+    }
+
+    erow *row = editorRowAt(editor.cursorY);
+    int tailLength = row->size - editor.cursorX;
+    char *tail = malloc(tailLength + 1);
+
+    memcpy(tail, &editorRowChars(row)[editor.cursorX], tailLength);
+
+    editorRowTruncate(row, editor.cursorX);
+    editorRowAppendString(row, s, newline - s);
+
+    char *line = newline + 1;
+    char *end = s + length;
+    int at = editor.cursorY + 1;
+
+    while((newline = memchr(line, '\n', end - line)) != NULL){
+        editorInsertRow(at++, line, newline - line);
+        line = newline + 1;
+    }
+
+    editorInsertRow(at, line, end - line);
+    editorRowAppendString(editorRowAt(at), tail, tailLength);
+
+    free(tail);
+
+    editor.cursorY = at;
+    editor.cursorX = end - line;
+}
+
+int editorIsWordChar(int character){
+    return !isspace((unsigned char)character);
+}
+
+int editorWordStarts(int prev, int character){
+    return editorIsWordChar(character) && !editorIsWordChar(prev);
+}
+
+void editorCountString(char *s, size_t length, int *words, int *characters){
+    int prev = ' ';
+
+    *words = 0;
+    *characters = 0;
+
+    for(size_t i = 0; i < length; i++){
+        *words += editorWordStarts(prev, s[i]);
+        *characters += editorIsWordChar(s[i]);
+
+        prev = s[i];
+    }
+}
+
+void editorRowSetCounts(erow *row, int words, int characters){
+    editor.wordCount += words - row->words;
+    editor.characterCount += characters - row->characters;
+
+    row->words = words;
+    row->characters = characters;
+}
+
+long editorWordCount(){
+    return editor.wordCount;
+}
+
+long editorCharacterCount(){
+    return editor.characterCount;
+}
+
+void editorOpen(char *filename){
+    free(editor.filename);
+    editor.filename = strdup(filename);
+
+    editorSyntaxSelect();
+
+    int fd = open(filename, O_RDONLY);
+
+    if(fd == -1){
+        die("open");
+    }
+
+    struct stat st;
+
+    if((fstat(fd, &st) != -1) && S_ISREG(st.st_mode) && (st.st_size > 0)){
+        char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if(map != MAP_FAILED){
+            editor.map = map;
+            editor.mapFd = fd;
+            editor.mapSize = st.st_size;
+            editor.mapIndexed = 0;
+
+            editorLoadRows(editor.screenRows + 1);
+            editorStartIndexing();
+
+            editor.dirty = 0;
+
+            editorSwapOpen(filename);
+
+            return;
+        }
+    }
+
+    FILE *fp = fdopen(fd, "r");
+
+    if(!fp){
+        die("fdopen");
+    }
+
+    char *line = NULL;
+    size_t linecap = 0;
+    ssize_t linelen;
+
+    editor.undo.suspended = 1;
+
+    while((linelen = getline(&line, &linecap, fp)) != -1){
+        while((linelen > 0) && ((line[linelen - 1] == '\n') || (line[linelen - 1] == '\r'))){
+            linelen--;
+        }
+
+        editorInsertRow(editor.numRows, line, linelen);
+    }
+
+    free(line);
+    fclose(fp);
+
+    editor.undo.suspended = 0;
+
+    editor.dirty = 0;
+
+    editorSwapOpen(filename);
+}
+
+int editorIndexPending(){
+    return (editor.map != NULL) && (editor.mapIndexed < editor.mapSize);
+}
+
+void editorInitIndex(){
+    struct indexState *index = &editor.index;
+
+    if(pipe(index->notifyPipe) == -1){
+        die("pipe");
+    }
+
+    fcntl(index->notifyPipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(index->notifyPipe[1], F_SETFL, O_NONBLOCK);
+    pthread_mutex_init(&index->lock, NULL);
+}
+
+void editorIndexLine(struct indexChunk *chunk, size_t start, size_t end, int words, int characters, int tabs){
+    while((end > start) && (editor.map[end - 1] == '\r')){
+        end--;
+    }
+
+    if(chunk->count == chunk->capacity){
+        chunk->capacity = chunk->capacity ? (chunk->capacity * 2) : 4096;
+        chunk->lines = realloc(chunk->lines, sizeof(struct indexedLine) * chunk->capacity);
+    }
+
+    struct indexedLine *line = &chunk->lines[chunk->count++];
+
+    line->offset = start;
+    line->length = end - start;
+    line->words = words;
+    line->characters = characters;
+    line->tabs = tabs;
+}
+
+POPCNT_CLONES void editorScanChunk(struct indexChunk *chunk){
+    const char *map = editor.map;
+    size_t at = chunk->start;
+    size_t lineStart = at;
+    int words = 0, characters = 0, tabs = 0;
+    int prevWord = 0;
+
+#ifdef __SSE2__
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i low = _mm_set1_epi8('\t' - 1);
+    const __m128i high = _mm_set1_epi8('\r' + 1);
+
+    for(; at + 16 <= chunk->end; at += 16){
+        __m128i block = _mm_loadu_si128((const __m128i *)&map[at]);
+        __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_and_si128(_mm_cmpgt_epi8(block, low), _mm_cmplt_epi8(block, high)));
+
+        unsigned int word = ~(unsigned int)_mm_movemask_epi8(blank) & 0xffff;
+        unsigned int starts = word & ~((word << 1) | prevWord);
+        unsigned int tabMask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, tab));
+        unsigned int breaks = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+        unsigned int rest = 0xffff;
+
+        while(breaks != 0){
+            int bit = __builtin_ctz(breaks);
+            unsigned int part = rest & ((2u << bit) - 1);
+
+            words += __builtin_popcount(starts & part);
+            characters += __builtin_popcount(word & part);
+            tabs += __builtin_popcount(tabMask & part);
+
+            editorIndexLine(chunk, lineStart, at + bit, words, characters, tabs);
+
+            lineStart = at + bit + 1;
+            words = characters = tabs = 0;
+
+            rest &= ~part;
+            breaks &= breaks - 1;
+        }
+
+        words += __builtin_popcount(starts & rest);
+        characters += __builtin_popcount(word & rest);
+        tabs += __builtin_popcount(tabMask & rest);
+
+        prevWord = word >> 15;
+    }
+#endif
+
+    for(; at < chunk->end; at++){
+        if(map[at] == '\n'){
+            editorIndexLine(chunk, lineStart, at, words, characters, tabs);
+
+            lineStart = at + 1;
+            words = characters = tabs = 0;
+            prevWord = 0;
+
+            continue;
+        }
+
+        int isWord = editorIsWordChar(map[at]);
+
+        words += isWord && !prevWord;
+        characters += isWord;
+        tabs += (map[at] == '\t');
+
+        prevWord = isWord;
+    }
+
+    if(lineStart < chunk->end){
+        editorIndexLine(chunk, lineStart, chunk->end, words, characters, tabs);
+    }
+}
+
+void *editorIndexWorker(void *arg){
+    struct indexState *index = arg;
+
+    while(1){
+        pthread_mutex_lock(&index->lock);
+
+        int claimed = index->cancel ? index->numChunks : index->nextChunk++;
+
+        pthread_mutex_unlock(&index->lock);
+
+        if(claimed >= index->numChunks){
+            return NULL;
+        }
+
+        struct indexChunk *chunk = &index->chunks[claimed];
+
+        editorScanChunk(chunk);
+
+        pthread_mutex_lock(&index->lock);
+        chunk->done = 1;
+        pthread_mutex_unlock(&index->lock);
+
+        write(index->notifyPipe[1], "i", 1);
+    }
+}
+
+void editorStartIndexing(){
+    struct indexState *index = &editor.index;
+    size_t remaining = editor.mapSize - editor.mapIndexed;
+
+    if(remaining < INDEX_BATCH_BYTES){
+        return;
+    }
+
+    index->numChunks = 0;
+    index->chunks = malloc(sizeof(struct indexChunk) * ((remaining / INDEX_CHUNK_BYTES) + 1));
+
+    size_t start = editor.mapIndexed;
+
+    while(start < editor.mapSize){
+        size_t end = editor.mapSize;
+
+        if(editor.mapSize - start > INDEX_CHUNK_BYTES){
+            char *newline = memchr(&editor.map[start + INDEX_CHUNK_BYTES], '\n', editor.mapSize - start - INDEX_CHUNK_BYTES);
+
+            if(newline != NULL){
+                end = (newline - editor.map) + 1;
+            }
+        }
+
+        struct indexChunk *chunk = &index->chunks[index->numChunks++];
+
+        memset(chunk, 0, sizeof(*chunk));
+        chunk->start = start;
+        chunk->end = end;
+
+        start = end;
+    }
+
+    index->nextChunk = 0;
+    index->current = 0;
+    index->cancel = 0;
+
+    int threads = editorWorkerThreads();
+
+    if(threads > index->numChunks){
+        threads = index->numChunks;
+    }
+
+    for(index->numThreads = 0; index->numThreads < threads; index->numThreads++){
+        if(pthread_create(&index->threads[index->numThreads], NULL, editorIndexWorker, index) != 0){
+            break;
+        }
+    }
+
+    if(index->numThreads == 0){
+        free(index->chunks);
+
+        index->chunks = NULL;
+        index->numChunks = 0;
+    }
+}
+
+void editorStopIndexing(){
+    struct indexState *index = &editor.index;
+
+    pthread_mutex_lock(&index->lock);
+    index->cancel = 1;
+    pthread_mutex_unlock(&index->lock);
+
+    for(int i = 0; i < index->numThreads; i++){
+        pthread_join(index->threads[i], NULL);
+    }
+
+    for(int i = 0; i < index->numChunks; i++){
+        free(index->chunks[i].lines);
+    }
+
+    free(index->chunks);
+
+    index->chunks = NULL;
+    index->numChunks = 0;
+    index->numThreads = 0;
+    index->current = 0;
+}
+
+struct indexChunk *editorIndexChunk(){
+    struct indexState *index = &editor.index;
+
+    while((index->current < index->numChunks) && (index->chunks[index->current].end <= editor.mapIndexed)){
+        struct indexChunk *passed = &index->chunks[index->current];
+
+        pthread_mutex_lock(&index->lock);
+
+        if(passed->done){
+            free(passed->lines);
+
+            passed->lines = NULL;
+        }
+
+        pthread_mutex_unlock(&index->lock);
+
+        index->current++;
+    }
+
+    if(index->current == index->numChunks){
+        return NULL;
+    }
+
+    struct indexChunk *chunk = &index->chunks[index->current];
+
+    pthread_mutex_lock(&index->lock);
+    int done = chunk->done;
+    pthread_mutex_unlock(&index->lock);
+
+    if(!done){
+        return NULL;
+    }
+
+    while((chunk->next < chunk->count) && (chunk->lines[chunk->next].offset < editor.mapIndexed)){
+        chunk->next++;
+    }
+
+    return (chunk->next < chunk->count) ? chunk : NULL;
+}
+
+int editorIndexReady(){
+    return (editorIndexChunk() != NULL) || (editor.index.current == editor.index.numChunks);
+}
+
+void editorIndexWait(){
+    while(editorIndexPending() && !editorIndexReady()){
+        struct pollfd fd = {editor.index.notifyPipe[0], POLLIN, 0};
+
+        if((poll(&fd, 1, -1) == -1) && (errno != EINTR)){
+            die("poll");
+        }
+
+        char drain[16];
+
+        while(read(editor.index.notifyPipe[0], drain, sizeof(drain)) > 0);
+    }
+}
+
+void editorIndexBatch(size_t bytes){
+    size_t end = editor.mapIndexed + bytes;
+
+    while(editorIndexPending() && (editor.mapIndexed < end)){
+        struct indexChunk *chunk = editorIndexChunk();
+
+        if(chunk != NULL){
+            struct indexedLine *line = &chunk->lines[chunk->next++];
+
+            editor.mapIndexed = (chunk->next < chunk->count) ? chunk->lines[chunk->next].offset : chunk->end;
+
+            editorAppendMappedRow(&editor.map[line->offset], line->length, line->words, line->characters, line->tabs);
+
+            if(chunk->next == chunk->count){
+                free(chunk->lines);
+
+                chunk->lines = NULL;
+                chunk->count = 0;
+                chunk->next = 0;
+            }
+
+            continue;
+        }
+
+        char *line = &editor.map[editor.mapIndexed];
+        size_t remaining = editor.mapSize - editor.mapIndexed;
+        char *newline = memchr(line, '\n', remaining);
+        size_t linelen = newline ? (size_t)(newline - line) : remaining;
+
+        editor.mapIndexed += newline ? (linelen + 1) : linelen;
+
+        while((linelen > 0) && (line[linelen - 1] == '\r')){
+            linelen--;
+        }
+
+        int words, characters;
+        editorCountString(line, linelen, &words, &characters);
+
+        editorAppendMappedRow(line, linelen, words, characters, memchr(line, '\t', linelen) != NULL);
+    }
+}
+
+void editorLoadRows(int count){
+    while(editorIndexPending() && (editor.numRows < count)){
+        editorIndexBatch(1);
+    }
+}
+
+void editorLoadAllRows(){
+    while(editorIndexPending()){
+        editorIndexWait();
+        editorIndexBatch(INDEX_BATCH_BYTES);
+    }
+}
+
+int editorWriteAll(int fd, struct iovec *iov, int count){
+    while(count > 0){
+        ssize_t written = writev(fd, iov, count);
+
+        if(written == -1){
+            if(errno == EINTR){
+                continue;
+            }
+
+            return -1;
+        }
+
+        if(written == 0){
+            errno = EIO;
+
+            return -1;
+        }
+
+        while((count > 0) && ((size_t)written >= iov->iov_len)){
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+
+        if(count > 0){
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    return 0;
+}
+
+void editorRetireChars(char *chars, int capacity){
+    struct saveState *save = &editor.save;
+
+    if(save->numRetired == save->retiredCapacity){
+        save->retiredCapacity = save->retiredCapacity ? (save->retiredCapacity * 2) : 64;
+        save->retired = realloc(save->retired, sizeof(struct retiredChars) * save->retiredCapacity);
+    }
+
+    save->retired[save->numRetired].chars = chars;
+    save->retired[save->numRetired].capacity = capacity;
+    save->numRetired++;
+}
+
+void editorSaveAppend(char *chars, size_t length){
+    struct saveState *save = &editor.save;
+
+    save->bytes += length;
+
+    while(length > 0){
+        struct iovec *last = (save->count > 0) ? &save->iov[save->count - 1] : NULL;
+        size_t piece;
+
+        if((last != NULL) && ((char *)last->iov_base + last->iov_len == chars) && (last->iov_len < SAVE_CHUNK_BYTES)){
+            piece = SAVE_CHUNK_BYTES - last->iov_len;
+            piece = (length < piece) ? length : piece;
+
+            last->iov_len += piece;
+        }
+        else{
+            if(save->count == save->capacity){
+                save->capacity = save->capacity ? (save->capacity * 2) : 1024;
+                save->iov = realloc(save->iov, sizeof(struct iovec) * save->capacity);
+            }
+
+            piece = (length < SAVE_CHUNK_BYTES) ? length : SAVE_CHUNK_BYTES;
+
+            save->iov[save->count].iov_base = chars;
+            save->iov[save->count].iov_len = piece;
+            save->count++;
+        }
+
+        chars += piece;
+        length -= piece;
+    }
+}
+
+void editorSnapshotRows(){
+    struct saveState *save = &editor.save;
+
+    save->count = 0;
+    save->bytes = 0;
+
+    if(editorIndexPending() && (memchr(&editor.map[editor.mapIndexed], '\r', editor.mapSize - editor.mapIndexed) != NULL)){
+        editorLoadAllRows();
+    }
+
+    for(rowBlock *block = editor.firstBlock; block != NULL; block = block->next){
+        for(int i = 0; i < block->count; i++){
+            erow *row = &block->rows[i];
+            char *chars = editorRowChars(row);
+            int terminated = row->mapped && (chars + row->size < editor.map + editor.mapSize) && (chars[row->size] == '\n');
+
+            editorSaveAppend(chars, row->size + terminated);
+
+            if(!terminated){
+                editorSaveAppend("\n", 1);
+            }
+
+            if(!row->mapped){
+                row->frozen = 1;
+            }
+        }
+    }
+
+    if(editorIndexPending()){
+        editorSaveAppend(&editor.map[editor.mapIndexed], editor.mapSize - editor.mapIndexed);
+
+        if(editor.map[editor.mapSize - 1] != '\n'){
+            editorSaveAppend("\n", 1);
+        }
+    }
+}
+
+int editorSaveFromSource(struct saveState *save, struct iovec *iov){
+    char *chars = iov->iov_base;
+
+    return (save->source != -1) && (iov->iov_len >= SAVE_COPY_MIN_BYTES) && (chars >= save->sourceMap) && (chars < save->sourceMap + save->sourceSize);
+}
+
+int editorCopySpan(struct saveState *save, struct iovec *iov){
+    char *chars = iov->iov_base;
+    size_t length = iov->iov_len;
+    loff_t offset = chars - save->sourceMap;
+
+    while(length > 0){
+        ssize_t copied = copy_file_range(save->source, &offset, save->fd, NULL, length, 0);
+
+        if(copied > 0){
+            chars += copied;
+            length -= copied;
+            save->reused += copied;
+
+            continue;
+        }
+
+        if((copied == -1) && (errno == EINTR)){
+            continue;
+        }
+
+        if((copied == -1) && (errno != EXDEV) && (errno != ENOSYS) && (errno != EINVAL) && (errno != EOPNOTSUPP)){
+            return -1;
+        }
+
+        save->source = -1;
+
+        break;
+    }
+
+    struct iovec rest = {chars, length};
+
+    return editorWriteAll(save->fd, &rest, (length > 0) ? 1 : 0);
+}
+
+int editorSyncDirectory(const char *path){
+    char *slash = strrchr(path, '/');
+    char *directory = (slash == NULL) ? strdup(".") : (slash == path) ? strdup("/") : strndup(path, slash - path);
+    int fd = open(directory, O_RDONLY | O_DIRECTORY);
+
+    free(directory);
+
+    if(fd == -1){
+        return -1;
+    }
+
+    int result = fsync(fd);
+    int error = errno;
+
+    close(fd);
+
+    if((result == -1) && (error != EINVAL)){
+        errno = error;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+void *editorSaveWorker(void *arg){
+    struct saveState *save = arg;
+    int error = 0;
+    int at = 0;
+
+    while((at < save->count) && (error == 0)){
+        int batch = 0;
+        long long bytes = 0;
+
+        if(editorSaveFromSource(save, &save->iov[at])){
+            bytes = save->iov[at].iov_len;
+
+            if(editorCopySpan(save, &save->iov[at]) == -1){
+                error = errno;
+            }
+
+            batch = 1;
+        }
+        else{
+            while((at + batch < save->count) && (batch < IOV_MAX) && (bytes < SAVE_CHUNK_BYTES) && !editorSaveFromSource(save, &save->iov[at + batch])){
+                bytes += save->iov[at + batch].iov_len;
+                batch++;
+            }
+
+            if(editorWriteAll(save->fd, &save->iov[at], batch) == -1){
+                error = errno;
+            }
+        }
+
+        at += batch;
+
+        pthread_mutex_lock(&save->lock);
+        save->written += bytes;
+        pthread_mutex_unlock(&save->lock);
+    }
+
+    if((error == 0) && (fsync(save->fd) == -1)){
+        error = errno;
+    }
+
+    if((close(save->fd) == -1) && (error == 0)){
+        error = errno;
+    }
+
+    if((error == 0) && (rename(save->temp, save->target) == -1)){
+        error = errno;
+    }
+
+    if(error != 0){
+        unlink(save->temp);
+    }
+    else if(editorSyncDirectory(save->target) == -1){
+        error = errno;
+    }
+
+    pthread_mutex_lock(&save->lock);
+    save->error = error;
+    pthread_mutex_unlock(&save->lock);
+
+    write(save->notifyPipe[1], "s", 1);
+
+    return NULL;
+}
+
+void editorSave(){
+    struct saveState *save = &editor.save;
+
+    if(save->active){
+        editorSetStatusMessage("Save already in progress");
+
+        return;
+    }
+
+    if(editor.filename == NULL){
+        editor.filename = editorPrompt("Save as: %s", NULL);
+
+        if(editor.filename == NULL){
+            editorSetStatusMessage("Save aborted");
+
+            return;
+        }
+
+        editorSyntaxSelect();
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &save->start);
+
+    char *path = realpath(editor.filename, NULL);
+
+    save->target = (path != NULL) ? path : strdup(editor.filename);
+
+    size_t tempLength = strlen(save->target) + 8;
+    save->temp = malloc(tempLength);
+
+    snprintf(save->temp, tempLength, "%s.XXXXXX", save->target);
+
+    save->fd = mkstemp(save->temp);
+
+    if(save->fd != -1){
+        struct stat st;
+        mode_t mode;
+
+        if(stat(save->target, &st) == 0){
+            mode = st.st_mode & 07777;
+        }
+        else{
+            mode_t mask = umask(0);
+            umask(mask);
+
+            mode = 0666 & ~mask;
+        }
+
+        if(fchmod(save->fd, mode) == -1){
+            int error = errno;
+
+            close(save->fd);
+            unlink(save->temp);
+
+            errno = error;
+            save->fd = -1;
+        }
+    }
+
+    if(save->fd == -1){
+        editorSetStatusMessage("Can't save! I/O error: %s", strerror(errno));
+
+        free(save->temp);
+        free(save->target);
+
+        return;
+    }
+
+    editorSnapshotRows();
+
+    save->source = editor.mapFd;
+    save->sourceMap = editor.map;
+    save->sourceSize = editor.mapSize;
+    save->written = 0;
+    save->reused = 0;
+    save->error = 0;
+    save->dirty = editor.dirty;
+    save->swapLength = editor.swap.written + editor.swap.length;
+
+    if(pthread_create(&save->thread, NULL, editorSaveWorker, save) != 0){
+        die("pthread_create");
+    }
+
+    save->active = 1;
+
+    editorSaveProgress();
+}
+
+void editorSaveProgress(){
+    struct saveState *save = &editor.save;
+
+    if(!save->active){
+        return;
+    }
+
+    pthread_mutex_lock(&save->lock);
+    long long written = save->written;
+    pthread_mutex_unlock(&save->lock);
+
+    int percent = (save->bytes > 0) ? (int)(written * 100 / save->bytes) : 100;
+
+    editorSetStatusMessage("Saving... %d%% (%lld of %lld bytes)", percent, written, save->bytes);
+}
+
+void editorFinishSave(){
+    struct saveState *save = &editor.save;
+
+    if(!save->active){
+        return;
+    }
+
+    pthread_join(save->thread, NULL);
+
+    save->active = 0;
+
+    char drain[16];
+
+    while(read(save->notifyPipe[0], drain, sizeof(drain)) > 0);
+
+    for(int i = 0; i < save->numRetired; i++){
+        editorSlabFree(save->retired[i].chars, save->retired[i].capacity);
+    }
+
+    save->numRetired = 0;
+
+    for(rowBlock *block = editor.firstBlock; block != NULL; block = block->next){
+        for(int i = 0; i < block->count; i++){
+            block->rows[i].frozen = 0;
+        }
+    }
+
+    free(save->temp);
+    free(save->target);
+
+    if(save->error != 0){
+        editorSetStatusMessage("Can't save! I/O error: %s", strerror(save->error));
+
+        return;
+    }
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = editorElapsedNs(&save->start, &end) / 1e9;
+    double throughput = (seconds > 0) ? (save->bytes / (1024.0 * 1024.0) / seconds) : 0;
+
+    editor.dirty -= save->dirty;
+
+    editorSwapRebase(editor.filename, save->swapLength);
+
+    editorSetStatusMessage("%lld bytes written to disk (%.1f MB/s, %lld reused)", save->bytes, throughput, save->reused);
+}
+
+void editorSearchCompile(char *query){
+    struct searchState *search = &editor.search;
+
+    free(search->query);
+
+    search->query = strdup(query);
+    search->length = strlen(query);
+
+    for(int i = 0; i < 256; i++){
+        search->skip[i] = search->length;
+    }
+
+    for(int i = 0; i < search->length - 1; i++){
+        search->skip[(unsigned char)query[i]] = search->length - 1 - i;
+    }
+}
+
+int editorSearchRow(erow *row, int from, int before){
+    struct searchState *search = &editor.search;
+    int length = search->length;
+    unsigned char last = search->query[length - 1];
+    char *chars = editorRowChars(row);
+
+    if(before > row->size - length + 1){
+        before = row->size - length + 1;
+    }
+
+    int at = from;
+
+    while(at < before){
+        char *hit = memchr(&chars[at + length - 1], last, before - at);
+
+        if(hit == NULL){
+            return -1;
+        }
+
+        at = (hit - chars) - (length - 1);
+
+        if(memcmp(&chars[at], search->query, length - 1) == 0){
+            return at;
+        }
+
+        at += search->skip[last];
+    }
+
+    return -1;
+}
+
+int editorSearchRowLast(erow *row, int from, int before){
+    int found = -1;
+    int at;
+
+    while((at = editorSearchRow(row, from, before)) != -1){
+        found = at;
+        from = at + 1;
+    }
+
+    return found;
+}
+
+int editorSearchForward(int row, int column, int endRow, int endColumn){
+    int first = 1;
+
+    while(1){
+        editorLoadRows(row + 1);
+
+        if(editor.numRows == 0){
+            return 0;
+        }
+
+        if(row >= editor.numRows){
+            row = 0;
+            column = 0;
+
+            continue;
+        }
+
+        int stop = (row == endRow) && (!first || (endColumn > column));
+        int at = editorSearchRow(editorRowAt(row), column, stop ? endColumn : INT_MAX);
+
+        if(at != -1){
+            editorSearchJump(row, at);
+
+            return 1;
+        }
+
+        if(stop){
+            return 0;
+        }
+
+        row++;
+        column = 0;
+        first = 0;
+    }
+}
+
+int editorSearchBackward(int row, int column){
+    for(int i = row; i >= 0; i--){
+        int at = editorSearchRowLast(editorRowAt(i), 0, (i == row) ? column : INT_MAX);
+
+        if(at != -1){
+            editorSearchJump(i, at);
+
+            return 1;
+        }
+    }
+
+    editorLoadAllRows();
+
+    for(int i = editor.numRows - 1; i >= row; i--){
+        int at = editorSearchRowLast(editorRowAt(i), (i == row) ? column : 0, INT_MAX);
+
+        if(at != -1){
+            editorSearchJump(i, at);
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void editorSearchJump(int row, int column){
+    struct searchState *search = &editor.search;
+
+    search->matchRow = row;
+    search->matchColumn = column;
+
+    editor.cursorY = row;
+    editor.cursorX = column;
+
+    if((row < editor.rowOff) || (row >= editor.rowOff + editor.screenRows)){
+        editor.rowOff = (row > editor.screenRows / 2) ? (row - editor.screenRows / 2) : 0;
+    }
+}
+
+void editorFindCallback(char *query, int key){
+    struct searchState *search = &editor.search;
+
+    if((key == '\r') || (key == '\x1b')){
+        return;
+    }
+
+    if((key == ARROW_RIGHT) || (key == ARROW_DOWN) || (key == ARROW_LEFT) || (key == ARROW_UP)){
+        if(search->matchRow == -1){
+            return;
+        }
+
+        if((key == ARROW_RIGHT) || (key == ARROW_DOWN)){
+            editorSearchForward(search->matchRow, search->matchColumn + 1, search->matchRow, search->matchColumn + 1);
+        }
+        else{
+            editorSearchBackward(search->matchRow, search->matchColumn);
+        }
+
+        search->originRow = search->matchRow;
+        search->originColumn = search->matchColumn;
+
+        return;
+    }
+
+    int length = strlen(query);
+
+    if((search->query != NULL) && (length == search->length) && (strcmp(query, search->query) == 0)){
+        return;
+    }
+
+    int extended = (search->length > 0) && (length > search->length) && (strncmp(query, search->query, search->length) == 0);
+    int startRow = search->originRow;
+    int startColumn = search->originColumn;
+
+    if(extended){
+        if(search->matchRow == -1){
+            editorSearchCompile(query);
+
+            return;
+        }
+
+        startRow = search->matchRow;
+        startColumn = search->matchColumn;
+    }
+
+    editorSearchCompile(query);
+
+    search->matchRow = -1;
+
+    if(length > 0){
+        editorSearchForward(startRow, startColumn, search->originRow, search->originColumn);
+    }
+    else{
+        editor.cursorX = search->savedCursorX;
+        editor.cursorY = search->savedCursorY;
+        editor.rowOff = search->savedRowOff;
+        editor.colOff = search->savedColOff;
+    }
+}
+
+void editorFind(){
+    struct searchState *search = &editor.search;
+
+    search->savedCursorX = editor.cursorX;
+    search->savedCursorY = editor.cursorY;
+    search->savedRowOff = editor.rowOff;
+    search->savedColOff = editor.colOff;
+
+    search->originRow = editor.cursorY;
+    search->originColumn = editor.cursorX;
+
+    if(search->originRow >= editor.numRows){
+        search->originRow = 0;
+        search->originColumn = 0;
+    }
+
+    search->matchRow = -1;
+
+    editorSearchCompile("");
+
+    char *query = editorPrompt("Search: %s (Use ESC/Arrows/Enter)", editorFindCallback);
+
+    if(query != NULL){
+        free(query);
+
+        return;
+    }
+
+    editor.cursorX = search->savedCursorX;
+    editor.cursorY = search->savedCursorY;
+    editor.rowOff = search->savedRowOff;
+    editor.colOff = search->savedColOff;
+}
+
+int editorWorkerThreads(){
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if(processors < 1){
+        return 1;
+    }
+
+    return (processors > WORKER_THREADS_MAX) ? WORKER_THREADS_MAX : processors;
+}
+
+int editorReplaceMatch(struct replaceWorker *worker, int row, int start, int end){
+    struct regexMatch *last = (worker->count > 0) ? &worker->matches[worker->count - 1] : NULL;
+
+    if((start == end) && (last != NULL) && (last->row == row) && (last->end == start)){
+        return end + 1;
+    }
+
+    if(worker->count == worker->capacity){
+        worker->capacity = worker->capacity ? (worker->capacity * 2) : 256;
+        worker->matches = realloc(worker->matches, sizeof(struct regexMatch) * worker->capacity);
+    }
+
+    struct regexMatch *match = &worker->matches[worker->count++];
+
+    match->row = row;
+    match->start = start;
+    match->end = end;
+
+    return (end > start) ? end : (end + 1);
+}
+
+void *editorReplaceWorker(void *arg){
+    struct replaceWorker *worker = arg;
+    struct replaceState *state = worker->state;
+    int rowIndex = worker->firstRow;
+    int scanned = 0;
+    int cancel = 0;
+
+    rowBlock *block = worker->firstBlock;
+
+    for(int b = 0; (b < worker->numBlocks) && !cancel; b++, block = block->next){
+        for(int i = 0; i < block->count; i++){
+            erow *row = &block->rows[i];
+            int at = 0;
+
+            while(at <= row->size){
+                regmatch_t match;
+                int flags = (at > 0) ? REG_NOTBOL : 0;
+
+#ifdef REG_STARTEND
+                match.rm_so = at;
+                match.rm_eo = row->size;
+
+                if(regexec(&worker->regex, row->chars, 1, &match, flags | REG_STARTEND) != 0){
+                    break;
+                }
+#else
+                char *line = strndup(&row->chars[at], row->size - at);
+                int result = regexec(&worker->regex, line, 1, &match, flags);
+
+                free(line);
+
+                if(result != 0){
+                    break;
+                }
+
+                match.rm_so += at;
+                match.rm_eo += at;
+#endif
+
+                at = editorReplaceMatch(worker, rowIndex, match.rm_so, match.rm_eo);
+            }
+
+            rowIndex++;
+            scanned++;
+        }
+
+        pthread_mutex_lock(&state->lock);
+
+        if(worker->numPublished + worker->count > worker->publishedCapacity){
+            worker->publishedCapacity = worker->numPublished + worker->count + 256;
+            worker->published = realloc(worker->published, sizeof(struct regexMatch) * worker->publishedCapacity);
+        }
+
+        memcpy(&worker->published[worker->numPublished], worker->matches, sizeof(struct regexMatch) * worker->count);
+        worker->numPublished += worker->count;
+        worker->rowsScanned += scanned;
+        cancel = state->cancel;
+
+        pthread_mutex_unlock(&state->lock);
+
+        worker->count = 0;
+        scanned = 0;
+    }
+
+    pthread_mutex_lock(&state->lock);
+    worker->done = 1;
+    pthread_mutex_unlock(&state->lock);
+
+    return NULL;
+}
+
+void editorReplaceRow(erow *row, struct regexMatch *matches, int count, char *replacement, int replacementLength){
+    int index = matches[0].row;
+    int length = row->size;
+
+    for(int i = 0; i < count; i++){
+        length += replacementLength - (matches[i].end - matches[i].start);
+    }
+
+    int capacity;
+    char *chars = editorSlabAlloc(length + 1, &capacity);
+    char *p = chars;
+    int copied = 0;
+
+    for(int i = 0; i < count; i++){
+        memcpy(p, &row->chars[copied], matches[i].start - copied);
+        p += matches[i].start - copied;
+
+        memcpy(p, replacement, replacementLength);
+        p += replacementLength;
+
+        copied = matches[i].end;
+    }
+
+    memcpy(p, &row->chars[copied], row->size - copied);
+    chars[length] = '\0';
+
+    editorJournalEdit(UNDO_DELETE_TEXT, index, 0, row->chars, row->size, 0);
+    editorJournalEdit(UNDO_INSERT_TEXT, index, 0, chars, length, 0);
+
+    if(row->chars == editor.gap.chars){
+        editor.gap.chars = NULL;
+    }
+
+    if(row->frozen){
+        editorRetireChars(row->chars, row->capacity);
+    }
+    else if(!row->mapped){
+        editorSlabFree(row->chars, row->capacity);
+    }
+
+    row->chars = chars;
+    row->capacity = capacity;
+    row->size = length;
+    row->mapped = 0;
+    row->frozen = 0;
+
+    int words, characters;
+    editorCountString(row->chars, row->size, &words, &characters);
+    editorRowSetCounts(row, words, characters);
+
+    editorRowIndexTabs(row);
+    editorUpdateRow(row);
+}
+
+int editorReplaceDrain(struct replaceState *state, char *replacement, int replacementLength, int *replaced, int *rows){
+    struct timespec start, now;
+    int remaining = 0;
+    int before = *rows;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    now = start;
+
+    for(int t = 0; t < state->numWorkers; t++){
+        struct replaceWorker *worker = &state->workers[t];
+
+        while(1){
+            if(worker->applied == worker->numPending){
+                free(worker->pending);
+
+                pthread_mutex_lock(&state->lock);
+
+                worker->pending = worker->published;
+                worker->numPending = worker->numPublished;
+                worker->applied = 0;
+
+                worker->published = NULL;
+                worker->numPublished = 0;
+                worker->publishedCapacity = 0;
+
+                pthread_mutex_unlock(&state->lock);
+
+                if(worker->numPending == 0){
+                    break;
+                }
+            }
+
+            if(editorElapsedNs(&start, &now) >= REPLACE_PROGRESS_MS * 1e6){
+                remaining = 1;
+
+                break;
+            }
+
+            struct regexMatch *matches = &worker->pending[worker->applied];
+            int same = 1;
+
+            while((worker->applied + same < worker->numPending) && (matches[same].row == matches[0].row)){
+                same++;
+            }
+
+            editorReplaceRow(editorRowAt(matches[0].row), matches, same, replacement, replacementLength);
+
+            worker->applied += same;
+            *replaced += same;
+            (*rows)++;
+
+            if((*rows % 1024) == 0){
+                clock_gettime(CLOCK_MONOTONIC, &now);
+            }
+        }
+    }
+
+    if(*rows != before){
+        editor.dirty++;
+    }
+
+    if(editor.cursorY < editor.numRows){
+        int size = editorRowAt(editor.cursorY)->size;
+
+        if(editor.cursorX > size){
+            editor.cursorX = size;
+        }
+    }
+
+    return remaining;
+}
+
+void editorReplace(){
+    char *command = editorPrompt("Replace: %s (regex/replacement)", NULL);
+
+    if(command == NULL){
+        return;
+    }
+
+    char *separator = command;
+
+    while((*separator != '\0') && (*separator != '/')){
+        if((separator[0] == '\\') && (separator[1] == '/')){
+            memmove(separator, separator + 1, strlen(separator));
+        }
+        else if((separator[0] == '\\') && (separator[1] != '\0')){
+            separator++;
+        }
+
+        separator++;
+    }
+
+    if(*separator == '\0'){
+        editorSetStatusMessage("Replace aborted: expected regex/replacement");
+        free(command);
+
+        return;
+    }
+
+    *separator = '\0';
+
+    char *replacement = separator + 1;
+    int replacementLength = strlen(replacement);
+
+    struct replaceState state;
+
+    memset(&state, 0, sizeof(state));
+    pthread_mutex_init(&state.lock, NULL);
+
+    editorLoadAllRows();
+    editorGapClose();
+
+    int threads = editorWorkerThreads();
+
+    if(threads > editor.numBlocks){
+        threads = (editor.numBlocks > 0) ? editor.numBlocks : 1;
+    }
+
+    int firstRow = 0;
+    rowBlock *block = editor.firstBlock;
+
+    for(int t = 0; t < threads; t++){
+        struct replaceWorker *worker = &state.workers[t];
+        int error = regcomp(&worker->regex, command, REG_EXTENDED);
+
+        if(error != 0){
+            char message[64];
+            regerror(error, &worker->regex, message, sizeof(message));
+
+            editorSetStatusMessage("Bad regex: %s", message);
+
+            pthread_mutex_lock(&state.lock);
+            state.cancel = 1;
+            pthread_mutex_unlock(&state.lock);
+
+            break;
+        }
+
+        worker->state = &state;
+        worker->firstBlock = block;
+        worker->numBlocks = (((t + 1) * editor.numBlocks) / threads) - ((t * editor.numBlocks) / threads);
+        worker->firstRow = firstRow;
+
+        for(int b = 0; b < worker->numBlocks; b++, block = block->next){
+            firstRow += block->count;
+        }
+
+        if(pthread_create(&worker->thread, NULL, editorReplaceWorker, worker) != 0){
+            regfree(&worker->regex);
+
+            die("pthread_create");
+        }
+
+        state.numWorkers++;
+    }
+
+    int cancelled = (state.numWorkers < threads);
+    int replaced = 0;
+    int rows = 0;
+
+    while(!cancelled){
+        int done = 1;
+        long scanned = 0;
+
+        pthread_mutex_lock(&state.lock);
+
+        for(int t = 0; t < state.numWorkers; t++){
+            done = done && state.workers[t].done;
+            scanned += state.workers[t].rowsScanned;
+        }
+
+        pthread_mutex_unlock(&state.lock);
+
+        int remaining = editorReplaceDrain(&state, replacement, replacementLength, &replaced, &rows);
+
+        if(done && !remaining){
+            break;
+        }
+
+        editorSetStatusMessage("Replacing... %d matches in %d rows, %ld%% of rows (Esc to cancel)", replaced, rows, (editor.numRows > 0) ? (scanned * 100 / editor.numRows) : 100);
+        editorRefreshScreen();
+
+        if(editorPollEscape(remaining ? 0 : REPLACE_PROGRESS_MS)){
+            pthread_mutex_lock(&state.lock);
+            state.cancel = 1;
+            pthread_mutex_unlock(&state.lock);
+
+            cancelled = 1;
+        }
+    }
+
+    for(int t = 0; t < state.numWorkers; t++){
+        struct replaceWorker *worker = &state.workers[t];
+
+        pthread_join(worker->thread, NULL);
+        regfree(&worker->regex);
+
+        free(worker->matches);
+        free(worker->published);
+        free(worker->pending);
+    }
+
+    pthread_mutex_destroy(&state.lock);
+    free(command);
+
+    if(state.numWorkers < threads){
+        return;
+    }
+
+    if(cancelled){
+        editorSetStatusMessage("Replace cancelled after %d matches in %d rows", replaced, rows);
+
+        return;
+    }
+
+    editorSetStatusMessage("Replaced %d matches in %d rows", replaced, rows);
+}
+
+void editorRowDelString(erow *row, int at, int length){
+    if((at < 0) || (length <= 0) || (at + length > row->size)){
+        return;
+    }
+
+    char *chars = editorRowChars(row);
+
+    if(editorJournaling()){
+        editorJournalEdit(UNDO_DELETE_TEXT, editorRowIndex(row), at, &chars[at], length, 0);
+    }
+
+    editorRowOwn(row);
+
+    chars = row->chars;
+
+    memmove(&chars[at], &chars[at + length], row->size - at - length + 1);
+
+    row->size -= length;
+
+    int words, characters;
+    editorCountString(chars, row->size, &words, &characters);
+    editorRowSetCounts(row, words, characters);
+
+    editorRowSpliceTabs(row, at, length, NULL, 0);
+    editorUpdateRow(row);
+
+    editor.dirty++;
+}
+
+size_t editorUndoRecordSize(int length){
+    return (sizeof(struct undoRecord) + length + 7) & ~(size_t)7;
+}
+
+struct undoRecord *editorUndoLast(){
+    struct undoLog *undo = &editor.undo;
+
+    if(undo->position == undo->start){
+        return NULL;
+    }
+
+    return (struct undoRecord *)&undo->arena[undo->position - undo->lastSize];
+}
+
+void editorUndoReserve(size_t bytes){
+    struct undoLog *undo = &editor.undo;
+
+    if(undo->end + bytes <= undo->capacity){
+        return;
+    }
+
+    if(undo->start > 0){
+        memmove(undo->arena, &undo->arena[undo->start], undo->end - undo->start);
+
+        undo->position -= undo->start;
+        undo->end -= undo->start;
+        undo->start = 0;
+    }
+
+    while(undo->end + bytes > undo->capacity){
+        undo->capacity = undo->capacity ? (undo->capacity * 2) : (64 * 1024);
+    }
+
+    undo->arena = realloc(undo->arena, undo->capacity);
+}
+
+void editorUndoReset(){
+    struct undoLog *undo = &editor.undo;
+
+    undo->start = 0;
+    undo->position = 0;
+    undo->end = 0;
+    undo->lastSize = 0;
+}
+
+void editorUndoEvict(){
+    struct undoLog *undo = &editor.undo;
+    struct undoRecord *last = editorUndoLast();
+    int lastGroup = (last != NULL) ? last->group : undo->group;
+
+    while((undo->end - undo->start > undo->limit) && (undo->start < undo->position)){
+        struct undoRecord *record = (struct undoRecord *)&undo->arena[undo->start];
+        int group = record->group;
+
+        if((group == undo->group) || (group == lastGroup)){
+            break;
+        }
+
+        while((undo->start < undo->position) && (((struct undoRecord *)&undo->arena[undo->start])->group == group)){
+            undo->start += editorUndoRecordSize(((struct undoRecord *)&undo->arena[undo->start])->length);
+        }
+
+        if(undo->start < undo->end){
+            ((struct undoRecord *)&undo->arena[undo->start])->previous = 0;
+        }
+
+        if(undo->start == undo->position){
+            undo->lastSize = 0;
+        }
+    }
+
+    if(undo->end - undo->start > undo->limit){
+        editorUndoReset();
+
+        undo->skipGroup = undo->group;
+
+        editorSetStatusMessage("Change too large for undo history (VERTEXT_UNDO_LIMIT)");
+    }
+}
+
+void editorUndoRecord(int type, int row, int column, const char *s, int length, int typed){
+    struct undoLog *undo = &editor.undo;
+
+    if(undo->suspended || (undo->skipGroup == undo->group)){
+        return;
+    }
+
+    undo->end = undo->position;
+
+    struct undoRecord *last = undo->sealed ? NULL : editorUndoLast();
+
+    undo->sealed = 0;
+
+    if((last != NULL) && (last->type == type) && (last->row == row) && ((last->group == undo->group) || (last->typed && typed))){
+        int append = 0;
+        int prepend = 0;
+
+        if(type == UNDO_INSERT_TEXT){
+            append = (column == last->column + last->length);
+        }
+        else if(type == UNDO_DELETE_TEXT){
+            append = (column == last->column);
+            prepend = !append && (column + length == last->column);
+        }
+        else if(type == UNDO_INSERT_ROWS){
+            append = (row == last->row + last->count);
+        }
+        else{
+            append = (row == last->row);
+        }
+
+        if(append || prepend){
+            int rows = (type == UNDO_INSERT_ROWS) || (type == UNDO_DELETE_ROWS);
+            int extra = length + rows;
+            size_t size = editorUndoRecordSize(last->length + extra);
+
+            editorUndoReserve(size - undo->lastSize);
+
+            size_t offset = undo->position - undo->lastSize;
+
+            last = (struct undoRecord *)&undo->arena[offset];
+
+            char *text = (char *)(last + 1);
+
+            if(prepend){
+                memmove(&text[length], text, last->length);
+                memcpy(text, s, length);
+
+                last->column = column;
+            }
+            else{
+                if(rows){
+                    text[last->length] = '\n';
+                }
+
+                memcpy(&text[last->length + extra - length], s, length);
+            }
+
+            last->length += extra;
+            last->count += rows;
+
+            undo->end = undo->position = offset + size;
+            undo->lastSize = size;
+
+            editorUndoEvict();
+
+            return;
+        }
+    }
+
+    size_t size = editorUndoRecordSize(length);
+
+    editorUndoReserve(size);
+
+    struct undoRecord *record = (struct undoRecord *)&undo->arena[undo->position];
+
+    record->type = type;
+    record->group = undo->group;
+    record->row = row;
+    record->column = column;
+    record->count = 1;
+    record->length = length;
+    record->previous = undo->lastSize;
+    record->typed = typed;
+
+    memcpy(record + 1, s, length);
+
+    undo->end = undo->position = undo->position + size;
+    undo->lastSize = size;
+
+    editorUndoEvict();
+}
+
+void editorUndoApply(struct undoRecord *record, int undo){
+    char *text = (char *)(record + 1);
+    int insert = (record->type == UNDO_INSERT_TEXT) || (record->type == UNDO_INSERT_ROWS);
+
+    if(undo){
+        insert = !insert;
+    }
+
+    if((record->type == UNDO_INSERT_TEXT) || (record->type == UNDO_DELETE_TEXT)){
+        erow *row = editorRowAt(record->row);
+
+        if(row == NULL){
+            return;
+        }
+
+        if(insert){
+            editorRowInsertString(row, record->column, text, record->length);
+        }
+        else{
+            editorRowDelString(row, record->column, record->length);
+        }
+
+        editor.cursorY = record->row;
+        editor.cursorX = record->column + (insert ? record->length : 0);
+
+        return;
+    }
+
+    if(insert){
+        char *line = text;
+        char *end = text + record->length;
+
+        for(int i = 0; i < record->count; i++){
+            char *newline = memchr(line, '\n', end - line);
+            int length = (newline != NULL) ? (newline - line) : (end - line);
+
+            editorInsertRow(record->row + i, line, length);
+
+            line += length + 1;
+        }
+    }
+    else{
+        for(int i = 0; i < record->count; i++){
+            editorDelRow(record->row);
+        }
+    }
+
+    editor.cursorY = record->row;
+    editor.cursorX = 0;
+}
+
+void editorUndo(){
+    struct undoLog *undo = &editor.undo;
+    struct undoRecord *record = editorUndoLast();
+
+    if(record == NULL){
+        editorSetStatusMessage("Nothing to undo");
+
+        return;
+    }
+
+    int group = record->group;
+
+    undo->suspended = 1;
+
+    while((record != NULL) && (record->group == group)){
+        editorUndoApply(record, 1);
+
+        undo->position -= undo->lastSize;
+        undo->lastSize = record->previous;
+
+        record = editorUndoLast();
+    }
+
+    undo->suspended = 0;
+    undo->sealed = 1;
+}
+
+void editorRedo(){
+    struct undoLog *undo = &editor.undo;
+
+    if(undo->position == undo->end){
+        editorSetStatusMessage("Nothing to redo");
+
+        return;
+    }
+
+    int group = ((struct undoRecord *)&undo->arena[undo->position])->group;
+
+    undo->suspended = 1;
+
+    while(undo->position < undo->end){
+        struct undoRecord *record = (struct undoRecord *)&undo->arena[undo->position];
+
+        if(record->group != group){
+            break;
+        }
+
+        editorUndoApply(record, 0);
+
+        undo->lastSize = editorUndoRecordSize(record->length);
+        undo->position += undo->lastSize;
+    }
+
+    undo->suspended = 0;
+    undo->sealed = 1;
+}
+
+int editorJournaling(){
+    return !editor.undo.suspended || (editor.swap.path != NULL);
+}
+
+void editorJournalEdit(int type, int row, int column, const char *s, int length, int typed){
+    if(editor.swap.path != NULL){
+        editorSwapRecord(type, row, column, s, length);
+    }
+
+    editorUndoRecord(type, row, column, s, length, typed);
+}
+
+char *editorSwapPath(char *filename){
+    char *slash = strrchr(filename, '/');
+    int directory = (slash != NULL) ? (slash - filename + 1) : 0;
+    size_t length = strlen(filename) + 8;
+    char *path = malloc(length);
+
+    snprintf(path, length, "%.*s.%s.vtswp", directory, filename, &filename[directory]);
+
+    return path;
+}
+
+void editorSwapHeader(struct stat *st){
+    struct swapHeader *header = &editor.swap.header;
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, SWAP_MAGIC, sizeof(header->magic));
+
+    header->size = st->st_size;
+    header->mtime = st->st_mtim.tv_sec;
+    header->mtimeNsec = st->st_mtim.tv_nsec;
+}
+
+void editorSwapOpen(char *filename){
+    struct swapJournal *swap = &editor.swap;
+    struct stat st;
+
+    if(stat(filename, &st) == -1){
+        return;
+    }
+
+    editorSwapHeader(&st);
+
+    char *path = editorSwapPath(filename);
+    int fd = open(path, O_RDWR | O_APPEND);
+
+    if(fd != -1){
+        struct stat journal;
+        char *map = MAP_FAILED;
+
+        if((fstat(fd, &journal) == 0) && (journal.st_size >= (off_t)sizeof(struct swapHeader))){
+            map = mmap(NULL, journal.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+
+        if((map == MAP_FAILED) || (memcmp(map, &swap->header, sizeof(swap->header)) != 0)){
+            if(map != MAP_FAILED){
+                munmap(map, journal.st_size);
+            }
+
+            close(fd);
+            unlink(path);
+
+            editorSetStatusMessage("Discarded swap file %s (file changed on disk)", path);
+        }
+        else{
+            size_t size = journal.st_size;
+            size_t offset = sizeof(struct swapHeader);
+            int replayed = 0;
+
+            editor.undo.suspended = 1;
+
+            while(offset + sizeof(struct undoRecord) <= size){
+                struct undoRecord *record = (struct undoRecord *)&map[offset];
+
+                if((record->type < UNDO_INSERT_TEXT) || (record->type > UNDO_DELETE_ROWS) || (record->length < 0) || (offset + editorUndoRecordSize(record->length) > size)){
+                    break;
+                }
+
+                editorLoadRows(record->row + record->count + 1);
+                editorUndoApply(record, 0);
+
+                offset += editorUndoRecordSize(record->length);
+                replayed++;
+            }
+
+            editor.undo.suspended = 0;
+
+            munmap(map, size);
+
+            if(ftruncate(fd, offset) == 0){
+                swap->fd = fd;
+                swap->written = offset - sizeof(struct swapHeader);
+            }
+            else{
+                close(fd);
+            }
+
+            editorSetStatusMessage("Recovered %d edits from %s", replayed, path);
+        }
+    }
+
+    swap->path = path;
+}
+
+void editorSwapRecord(int type, int row, int column, const char *s, int length){
+    struct swapJournal *swap = &editor.swap;
+    size_t size = editorUndoRecordSize(length);
+
+    if(swap->length + size > swap->capacity){
+        while(swap->length + size > swap->capacity){
+            swap->capacity = swap->capacity ? (swap->capacity * 2) : 4096;
+        }
+
+        swap->buffer = realloc(swap->buffer, swap->capacity);
+    }
+
+    struct undoRecord *record = (struct undoRecord *)&swap->buffer[swap->length];
+
+    memset(record, 0, size);
+
+    record->type = type;
+    record->row = row;
+    record->column = column;
+    record->count = 1;
+    record->length = length;
+
+    memcpy(record + 1, s, length);
+
+    swap->length += size;
+    swap->records++;
+}
+
+int editorSwapWrite(){
+    struct swapJournal *swap = &editor.swap;
+
+    if(swap->length == 0){
+        return 0;
+    }
+
+    if(swap->fd == -1){
+        swap->fd = open(swap->path, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0600);
+
+        if(swap->fd == -1){
+            return -1;
+        }
+
+        struct iovec iov = {&swap->header, sizeof(swap->header)};
+
+        if(editorWriteAll(swap->fd, &iov, 1) == -1){
+            return -1;
+        }
+
+        swap->written = 0;
+    }
+
+    struct iovec iov = {swap->buffer, swap->length};
+
+    if(editorWriteAll(swap->fd, &iov, 1) == -1){
+        return -1;
+    }
+
+    if(swap->unsynced == 0){
+        clock_gettime(CLOCK_MONOTONIC, &swap->pending);
+    }
+
+    swap->unsynced += swap->records;
+    swap->written += swap->length;
+    swap->length = 0;
+    swap->records = 0;
+
+    return 0;
+}
+
+void editorSwapCommit(){
+    if(editor.swap.path == NULL){
+        return;
+    }
+
+    if(editorSwapWrite() == -1){
+        editorSwapFail();
+
+        return;
+    }
+
+    if(editor.swap.unsynced >= SWAP_SYNC_OPS){
+        editorSwapSync();
+    }
+}
+
+void editorSwapSync(){
+    struct swapJournal *swap = &editor.swap;
+
+    if((swap->fd == -1) || (swap->unsynced == 0)){
+        return;
+    }
+
+    if(fdatasync(swap->fd) == -1){
+        editorSwapFail();
+
+        return;
+    }
+
+    swap->unsynced = 0;
+}
+
+int editorSwapTimeout(){
+    struct swapJournal *swap = &editor.swap;
+
+    if(swap->unsynced == 0){
+        return -1;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    double remaining = SWAP_SYNC_MS - editorElapsedNs(&swap->pending, &now) / 1e6;
+
+    return (remaining > 0) ? ((int)remaining + 1) : 0;
+}
+
+void editorSwapRebase(char *filename, size_t keep){
+    struct swapJournal *swap = &editor.swap;
+    struct stat st;
+
+    if(stat(filename, &st) == -1){
+        return;
+    }
+
+    if(swap->path == NULL){
+        swap->path = editorSwapPath(filename);
+        editorSwapHeader(&st);
+
+        return;
+    }
+
+    if(editorSwapWrite() == -1){
+        editorSwapFail();
+
+        return;
+    }
+
+    editorSwapHeader(&st);
+
+    if(swap->fd == -1){
+        return;
+    }
+
+    size_t tail = swap->written - keep;
+
+    if(tail == 0){
+        close(swap->fd);
+        unlink(swap->path);
+
+        swap->fd = -1;
+        swap->written = 0;
+        swap->unsynced = 0;
+
+        return;
+    }
+
+    char *records = malloc(tail);
+    struct iovec iov[2] = {{&swap->header, sizeof(swap->header)}, {records, tail}};
+
+    if((pread(swap->fd, records, tail, sizeof(struct swapHeader) + keep) != (ssize_t)tail) || (ftruncate(swap->fd, 0) == -1) || (editorWriteAll(swap->fd, iov, 2) == -1) || (fdatasync(swap->fd) == -1)){
+        free(records);
+        editorSwapFail();
+
+        return;
+    }
+
+    free(records);
+
+    swap->written = tail;
+    swap->unsynced = 0;
+}
+
+void editorSwapFail(){
+    editorSetStatusMessage("Swap file disabled! I/O error: %s", strerror(errno));
+
+    editorSwapDiscard();
+}
+
+void editorSwapDiscard(){
+    struct swapJournal *swap = &editor.swap;
+
+    if(swap->path == NULL){
+        return;
+    }
+
+    if(swap->fd != -1){
+        close(swap->fd);
+        unlink(swap->path);
+    }
+
+    free(swap->path);
+
+    swap->path = NULL;
+    swap->fd = -1;
+    swap->length = 0;
+    swap->records = 0;
+    swap->written = 0;
+    swap->unsynced = 0;
+}
+
+int editorStatusTimeout(){
+    if(editor.statusmsg[0] == '\0'){
+        return -1;
+    }
+
+    time_t remaining = editor.statusmsgTime + STATUS_MESSAGE_SECONDS - time(NULL);
+
+    if(remaining <= 0){
+        return -1;
+    }
+
+    return remaining * 1000;
+}
+
+void editorWaitForInput(){
+    while(1){
+        struct pollfd fds[4] = {{STDIN_FILENO, POLLIN, 0}, {editor.signalPipe[0], POLLIN, 0}, {editor.save.notifyPipe[0], POLLIN, 0}, {editor.index.notifyPipe[0], POLLIN, 0}};
+        int indexing = editorIndexPending() && editorIndexReady();
+        int timeout = indexing ? 0 : editorStatusTimeout();
+
+        if(editor.save.active && ((timeout == -1) || (timeout > SAVE_PROGRESS_MS))){
+            timeout = SAVE_PROGRESS_MS;
+        }
+
+        int swapTimeout = editorSwapTimeout();
+
+        if((swapTimeout != -1) && ((timeout == -1) || (timeout > swapTimeout))){
+            timeout = swapTimeout;
+        }
+
+        int ready = poll(fds, 4, timeout);
+
+        if(ready == -1){
+            if(errno == EINTR){
+                continue;
+            }
+
+            die("poll");
+        }
+
+        if(fds[1].revents & POLLIN){
+            char drain[16];
+
+            while(read(editor.signalPipe[0], drain, sizeof(drain)) > 0);
+
+            editorResize();
+            editorRefreshScreen();
+
+            continue;
+        }
+
+        if(fds[2].revents & POLLIN){
+            editorFinishSave();
+            editorRefreshScreen();
+
+            continue;
+        }
+
+        if(fds[3].revents & POLLIN){
+            char drain[16];
+
+            while(read(editor.index.notifyPipe[0], drain, sizeof(drain)) > 0);
+
+            continue;
+        }
+
+        if(fds[0].revents){
+            return;
+        }
+
+        if(indexing){
+            editorIndexBatch(INDEX_BATCH_BYTES);
+
+            if(editorIndexPending()){
+                continue;
+            }
+        }
+
+        if(editorSwapTimeout() == 0){
+            editorSwapSync();
+        }
+
+        editorSaveProgress();
+        editorRefreshScreen();
+    }
+}
+
+int editorFillInput(int wait){
+    if(editor.input.start < editor.input.end){
+        return 1;
+    }
+
+    int nread;
+
+    if(editor.headless){
+        size_t remaining = editor.input.scriptLength - editor.input.scriptOffset;
+
+        if(remaining == 0){
+            if(wait){
+                errno = ENODATA;
+                die("replay script");
+            }
+
+            return 0;
+        }
+
+        nread = (remaining < sizeof(editor.input.data)) ? remaining : sizeof(editor.input.data);
+
+        memcpy(editor.input.data, &editor.input.script[editor.input.scriptOffset], nread);
+        editor.input.scriptOffset += nread;
+    }
+    else{
+        if(wait){
+            editorWaitForInput();
+        }
+
+        nread = read(STDIN_FILENO, editor.input.data, sizeof(editor.input.data));
+    }
+
+    if((nread == -1) && (errno != EAGAIN) && (errno != EINTR)){
+        die("read");
+    }
+
+    if(nread <= 0){
+        return 0;
+    }
+
+    if(!editor.perf.inputPending){
+        clock_gettime(CLOCK_MONOTONIC, &editor.perf.input);
+        editor.perf.inputPending = 1;
+    }
+
+    editor.input.start = 0;
+    editor.input.end = nread;
+
+    return 1;
+}
+
+int editorPollEscape(int timeout){
+    struct inputBuffer *input = &editor.input;
+    struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+
+    if(editor.headless || (input->end - input->start == sizeof(input->data))){
+        fd.fd = -1;
+    }
+
+    if(poll(&fd, 1, timeout) <= 0){
+        return 0;
+    }
+
+    memmove(input->data, &input->data[input->start], input->end - input->start);
+    input->end -= input->start;
+    input->start = 0;
+
+    int nread = read(STDIN_FILENO, &input->data[input->end], sizeof(input->data) - input->end);
+
+    if((nread == 1) && (input->data[input->end] == '\x1b')){
+        return 1;
+    }
+
+    if(nread <= 0){
+        return 0;
+    }
+
+    if(!editor.perf.inputPending){
+        clock_gettime(CLOCK_MONOTONIC, &editor.perf.input);
+        editor.perf.inputPending = 1;
+    }
+
+    input->end += nread;
+
+    return 0;
+}
+
+int editorInputPending(){
+    if(editor.input.start < editor.input.end){
+        return 1;
+    }
+
+    struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+
+    return poll(&fd, 1, 0) > 0;
+}
+
+int editorFrameDue(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return editorElapsedNs(&editor.frame.painted, &now) >= editor.frame.interval * 1e6;
+}
+
+int editorReadByte(char *character, int wait){
+    if(!editorFillInput(wait)){
+        return 0;
+    }
+
+    *character = editor.input.data[editor.input.start++];
+
+    return 1;
+}
+
+int editorReadKey(){
+    char character;
+
+    while(!editorReadByte(&character, 1));
+
+    if(character == '\x1b'){
+        char seq[3];
+
+        if(!editorReadByte(&seq[0], 0)){
+            return '\x1b';
+        }
+
+        if(!editorReadByte(&seq[1], 0)){
+            return '\x1b';
+        }
+
+        if(seq[0] == '['){
+            if(seq[1] >= '0' && seq[1] <= '9'){
+                int code = seq[1] - '0';
+
+                while(1){
+                    if(!editorReadByte(&seq[2], 0)){
+                        return '\x1b';
+                    }
+
+                    if((seq[2] < '0') || (seq[2] > '9')){
+                        break;
+                    }
+
+                    code = (code * 10) + (seq[2] - '0');
+                }
+
+                if(seq[2] == '~'){
+                    switch(code){
+                        case 1: return HOME_KEY;
+                        case 3: return DEL_KEY;
+                        case 4: return END_KEY;
+                        case 5: return PAGE_UP;
+                        case 6: return PAGE_DOWN;
+                        case 7: return HOME_KEY;
+                        case 8: return END_KEY;
+                        case 200: return PASTE_START;
+                        case 201: return PASTE_END;
+                    }
+                }
+            }
+            else{
+                switch(seq[1]){
+                    case 'A': return ARROW_UP;
+                    case 'B': return ARROW_DOWN;
+                    case 'C': return ARROW_RIGHT;
+                    case 'D': return ARROW_LEFT;
+                    case 'H': return HOME_KEY;
+                    case 'F': return END_KEY;
+                }
+            }
+        }
+        else if(seq[0] == 'O'){
+            switch(seq[1]){
+                case 'H': return HOME_KEY;
+                case 'F': return END_KEY;
+            }
+        }
+
+        return '\x1b';
+    }
+    else{
+        return character;
+    }
+}
+
+char *editorReadPaste(size_t *length){
+    size_t bufsize = INPUT_BUFFER_SIZE;
+    size_t buflen = 0;
+    char *buf = malloc(bufsize);
+
+    while(1){
+        while(!editorFillInput(1));
+
+        int available = editor.input.end - editor.input.start;
+
+        if(buflen + available > bufsize){
+            while(buflen + available > bufsize){
+                bufsize *= 2;
+            }
+
+            buf = realloc(buf, bufsize);
+        }
+
+        memcpy(&buf[buflen], &editor.input.data[editor.input.start], available);
+        editor.input.start = editor.input.end;
+
+        size_t scanFrom = (buflen > 5) ? (buflen - 5) : 0;
+        buflen += available;
+
+        for(size_t i = scanFrom; i + 6 <= buflen; i++){
+            if((buf[i] == '\x1b') && (memcmp(&buf[i], "\x1b[201~", 6) == 0)){
+                size_t rest = buflen - (i + 6);
+
+                memcpy(editor.input.data, &buf[i + 6], rest);
+                editor.input.start = 0;
+                editor.input.end = rest;
+
+                *length = i;
+
+                return buf;
+            }
+        }
+    }
+}
+
+void editorProcessKeypress(){
+    static int quitTimes = QUIT_TIMES;
+
+    int character = editorReadKey();
+
+    editor.undo.group++;
+
+    switch(character){
+        case '\r':
+            editorInsertNewLine();
+            break;
+
+        case CTRL_KEY('q'):
+            editorFinishSave();
+
+            if(editor.dirty && quitTimes > 0){
+                editorSetStatusMessage("Unsaved changes! Press Ctrl-S to save the file or Ctrl-Q %d more times to quit.", quitTimes);
+                quitTimes--;
+
+                return;
+            }
+            editorSwapDiscard();
+
+            write(STDOUT_FILENO, "\x1b[2J", 4);
+            write(STDOUT_FILENO, "\x1b[H", 3);
+            exit(0);
+            break;
+
+        case CTRL_KEY('s'):
+            editorSave();
+            break;
+
+        case CTRL_KEY('f'):
+            editorFind();
+            break;
+
+        case CTRL_KEY('r'):
+            editorReplace();
+            break;
+
+        case CTRL_KEY('z'):
+            editorUndo();
+            break;
+
+        case CTRL_KEY('y'):
+            editorRedo();
+            break;
+
+        case PASTE_START:
+            {
+                size_t length;
+                char *text = editorReadPaste(&length);
+
+                editorInsertText(text, length);
+
+                free(text);
+            }
+            break;
+
+        case PASTE_END:
+            break;
+
+        case HOME_KEY:
+            editor.cursorX = 0;
+            break;
+
+        case END_KEY:
+            if(editor.cursorY < editor.numRows){
+                editor.cursorX = editorRowAt(editor.cursorY)->size;
+            }
+            break;
+
+        case BACKSPACE:
+        case CTRL_KEY('h'):
+        case DEL_KEY:
+            if(character == DEL_KEY){
+                editorMoveCursor(ARROW_RIGHT);
+            }
+            editorDelChar();
+            break;
+
+        case PAGE_UP:
+        case PAGE_DOWN:
+            {
+                if(character == PAGE_UP){
+                    editor.cursorY = editor.rowOff;
+                }
+                else if(character == PAGE_DOWN){
+                    editor.cursorY = editor.rowOff + editor.screenRows - 1;
+
+                    editorLoadRows(editor.cursorY + editor.screenRows + 1);
+
+                    if(editor.cursorY > editor.numRows){
+                        editor.cursorY = editor.numRows;
+                    }
+                }
+
+                int times = editor.screenRows;
+
+                while(times--){
+                    editorMoveCursor(character == PAGE_UP ? ARROW_UP : ARROW_DOWN);
+                }
+            }
+            break;
+        
+        case ARROW_UP:
+        case ARROW_DOWN:
+        case ARROW_LEFT:
+        case ARROW_RIGHT:
+            editorMoveCursor(character);
+            break;
+
+        case CTRL_KEY('l'):
+            editorInvalidateFrame();
+            break;
+
+        case CTRL_KEY('p'):
+            editor.perf.overlay = !editor.perf.overlay;
+            break;
+
+        case '\x1b':
+            break;
+
+        default:
+            editorInsertChar(character);
+            break;
+    }
+
+    editorSwapCommit();
+
+    quitTimes = QUIT_TIMES;
+}
+
+void editorScroll(){
+    editorLoadRows(editor.rowOff + editor.screenRows + 1);
+    editorLoadRows(editor.cursorY + 1);
+
+    editor.renderX = 0;
+    if(editor.cursorY < editor.numRows){
+        editor.renderX = editorRowcursorXToRx(editorRowAt(editor.cursorY), editor.cursorX);
+    }
+
+    if(editor.cursorY < editor.rowOff){
+        editor.rowOff = editor.cursorY;
+    }
+
+    if(editor.cursorY >= editor.rowOff + editor.screenRows){
+        editor.rowOff = editor.cursorY - editor.screenRows + 1;
+    }
+
+    if(editor.renderX < editor.colOff){
+        editor.colOff = editor.renderX;
+    }
+
+    if(editor.renderX >= editor.colOff + editor.screenColumns){
+        editor.colOff = editor.renderX - editor.screenColumns + 1;
+    }
+}
+
+void editorDamageRows(int from){
+    if(from < editor.frame.damageFrom){
+        editor.frame.damageFrom = from;
+    }
+}
+
+void editorInvalidateFrame(){
+    editor.frame.valid = 0;
+}
+
+void editorScrollFrame(struct appendBuffer *ab){
+    int delta = editor.rowOff - editor.frame.rowOff;
+    int distance = (delta < 0) ? -delta : delta;
+
+    if(!editor.frame.valid || (delta == 0) || (distance >= editor.screenRows) || (editor.colOff != editor.frame.colOff)){
+        return;
+    }
+
+    char buf[32];
+    int buflen = snprintf(buf, sizeof(buf), "\x1b[1;%dr\x1b[%d%c\x1b[r", editor.screenRows, distance, (delta > 0) ? 'S' : 'T');
+
+    abAppend(ab, buf, buflen);
+
+    struct appendBuffer *lines = editor.frame.lines;
+    int kept = editor.screenRows - distance;
+
+    abRotate(lines, editor.screenRows, (delta > 0) ? distance : kept);
+
+    for(int i = 0; i < distance; i++){
+        lines[(delta > 0) ? (kept + i) : i].length = 0;
+    }
+}
+
+void editorDrawLine(struct appendBuffer *ab, int y, const char *s, int length, const char *style){
+    struct appendBuffer *shadow = &editor.frame.lines[y];
+    int first = 0;
+    int last = length;
+    int clear = 1;
+
+    if(editor.frame.valid){
+        int common = (shadow->length < length) ? shadow->length : length;
+
+        while((first < common) && (shadow->buffer[first] == s[first])){
+            first++;
+        }
+
+        if((first == length) && (shadow->length == length)){
+            return;
+        }
+
+        int plain = 1;
+
+        for(int i = 0; i < shadow->length; i++){
+            if(((unsigned char)shadow->buffer[i] < ' ') || ((unsigned char)shadow->buffer[i] > '~')){
+                plain = 0;
+                break;
+            }
+        }
+
+        for(int i = first; plain && (i < length); i++){
+            if(((unsigned char)s[i] < ' ') || ((unsigned char)s[i] > '~')){
+                plain = 0;
+            }
+        }
+
+        if(!plain){
+            first = 0;
+        }
+        else if(shadow->length == length){
+            while((last > first) && (shadow->buffer[last - 1] == s[last - 1])){
+                last--;
+            }
+
+            clear = 0;
+        }
+        else{
+            clear = (length < shadow->length);
+        }
+    }
+
+    abAppendCursor(ab, y + 1, first + 1);
+
+    if(clear && (first == 0)){
+        abAppend(ab, "\x1b[K", 3);
+        clear = 0;
+    }
+
+    if(style){
+        abAppend(ab, style, strlen(style));
+    }
+
+    abAppend(ab, &s[first], last - first);
+
+    if(style){
+        abAppend(ab, "\x1b[m", 3);
+    }
+
+    if(clear){
+        abAppend(ab, "\x1b[K", 3);
+    }
+
+    shadow->length = 0;
+    abAppend(shadow, s, length);
+}
+
+void editorDrawHighlighted(struct appendBuffer *line, erow *row, const char *render, int length, const unsigned char *hl, int from){
+    int cursorX = editorRowRxToCursorX(row, editor.colOff);
+    int renderX = editorRowcursorXToRx(row, cursorX);
+    int current = HL_NORMAL;
+    int run = 0;
+    int idx = 0;
+
+    while(idx < length){
+        int next = editorRowcursorXToRx(row, cursorX + 1);
+        int columns = next - ((renderX > editor.colOff) ? renderX : editor.colOff);
+
+        if(columns > length - idx){
+            columns = length - idx;
+        }
+
+        int type = hl[cursorX - from];
+
+        if((columns > 0) && (type != current)){
+            abAppend(line, &render[run], idx - run);
+            abAppend(line, syntaxColors[type], strlen(syntaxColors[type]));
+
+            current = type;
+            run = idx;
+        }
+
+        if(columns > 0){
+            idx += columns;
+        }
+
+        renderX = next;
+        cursorX++;
+    }
+
+    abAppend(line, &render[run], idx - run);
+
+    if(current != HL_NORMAL){
+        abAppend(line, syntaxColors[HL_NORMAL], strlen(syntaxColors[HL_NORMAL]));
+    }
+}
+
+void editorDrawRows(struct appendBuffer *ab){
+    int moved = (editor.frame.rowOff != editor.rowOff) || (editor.frame.colOff != editor.colOff);
+    struct appendBuffer *line = &editor.frame.line;
+
+    editorSyntaxUpdate(editor.rowOff + editor.screenRows);
+
+    for(int i = 0; i < editor.screenRows; i++){
+        int filerow = i + editor.rowOff;
+
+        erow *row = editorRowAt(filerow);
+
+        if(editor.frame.valid && !moved && (filerow < editor.frame.damageFrom) && !(row && row->damaged)){
+            continue;
+        }
+
+        line->length = 0;
+
+        if(row){
+            int length;
+            char *render = editorRowRender(row, editor.colOff, editor.screenColumns, &length);
+
+            if((editor.syntax.definition != NULL) && (length > 0)){
+                int limit = editorRowRxToCursorX(row, editor.colOff + editor.screenColumns) + 1;
+
+                int start = editorRowRxToCursorX(row, editor.colOff);
+                int from;
+                unsigned char *hl = editorSyntaxHighlight(row, filerow, start, limit, &from);
+
+                editorDrawHighlighted(line, row, render, length, hl, from);
+            }
+            else{
+                abAppend(line, render, length);
+            }
+
+            row->damaged = 0;
+        }
+
+        editorDrawLine(ab, i, line->buffer, line->length, NULL);
+    }
+
+    editor.frame.rowOff = editor.rowOff;
+    editor.frame.colOff = editor.colOff;
+    editor.frame.damageFrom = INT_MAX;
+}
+
+void editorDrawStatusBar(struct appendBuffer *ab){
+    struct appendBuffer *line = &editor.frame.line;
+
+    long wordCount = editorWordCount();
+    long characterCount = editorCharacterCount();
+
+    char status[80], rstatus[80];
+    
+    int length;
+
+    if(editor.perf.overlay){
+        struct perfState *perf = &editor.perf;
+        size_t heap = editor.slab.arenaBytes + editor.slab.largeBytes + (editor.numBlocks * sizeof(rowBlock));
+
+        length = snprintf(status, sizeof(status), "frame %.0fus | %dB | input %.0fus | %d rows | %.1fMB", perf->frameNs / 1e3, editor.frame.bytes, perf->latencyNs / 1e3, editor.numRows, heap / (1024.0 * 1024.0));
+    }
+    else{
+        length = snprintf(status, sizeof(status), "Line: %d | Column: %d | Words: %ld | Characters: %ld", editor.cursorY + 1, editor.renderX + 1, wordCount, characterCount);
+    }
+
+    int renderLength = snprintf(rstatus, sizeof(rstatus), "%.20s - %d%s lines %s", editor.filename ? editor.filename : "[No Name]", editor.numRows, editorIndexPending() ? "+" : "", editor.dirty ? "(modified)" : "");
+
+    if(length > editor.screenColumns){
+        length = editor.screenColumns;
+    }
+
+    line->length = 0;
+    abAppend(line, status, length);
+
+    while(length < editor.screenColumns){
+        if((editor.screenColumns - length) == renderLength){
+            abAppend(line, rstatus, renderLength);
+            break;
+        }
+        else{
+            abAppend(line, " ", 1);
+            length++;
+        }
+    }
+
+    editorDrawLine(ab, editor.screenRows, line->buffer, line->length, "\x1b[7m");
+}
+
+void editorDrawMessageBar(struct appendBuffer *ab){
+    int msglen = strlen(editor.statusmsg);
+
+    if(msglen > editor.screenColumns){
+        msglen = editor.screenColumns;
+    }
+
+    if(!msglen || ((time(NULL) - editor.statusmsgTime) >= STATUS_MESSAGE_SECONDS)){
+        msglen = 0;
+    }
+
+    if(editor.perf.overlay && (msglen == 0)){
+        struct perfState *perf = &editor.perf;
+        char overlay[80];
+
+        msglen = snprintf(overlay, sizeof(overlay), "scroll %.0fus | draw %.0fus | count %.0fus | write %.0fus", perf->scrollNs / 1e3, perf->drawNs / 1e3, perf->countNs / 1e3, perf->writeNs / 1e3);
+
+        if(msglen > editor.screenColumns){
+            msglen = editor.screenColumns;
+        }
+
+        editorDrawLine(ab, editor.screenRows + 1, overlay, msglen, NULL);
+
+        return;
+    }
+
+    editorDrawLine(ab, editor.screenRows + 1, editor.statusmsg, msglen, NULL);
+}
+
+char *editorPrompt(char *prompt, void (*callback)(char *, int)){
+    size_t bufsize = 128;
+    char *buf = malloc(bufsize);
+
+    size_t buflen = 0;
+    buf[0] = '\0';
+
+    while(1){
+        editorSetStatusMessage(prompt, buf);
+        editorRefreshScreen();
+
+        int character = editorReadKey();
+
+        if((character == DEL_KEY) || (character == CTRL_KEY('h')) || (character == BACKSPACE)){
+            if(buflen != 0){
+                buf[--buflen] = '\0';
+            }
+        }
+        else if(character == '\x1b'){
+            editorSetStatusMessage("");
+
+            if(callback){
+                callback(buf, character);
+            }
+            
+            free(buf);
+
+            return NULL;
+        }
+        else if(character == '\r'){
+            if(buflen != 0){
+                editorSetStatusMessage("");
+
+                if(callback){
+                    callback(buf, character);
+                }
+                
+                return buf;
+            }
+        }
+        else if((!iscntrl(character)) && (character < 128)){
+            if(buflen == (bufsize - 1)){
+                bufsize *= 2;
+                buf = realloc(buf, bufsize);
+            }
+
+            buf[buflen++] = character;
+            buf[buflen] = '\0';
+        }
+
+        if(callback){
+            callback(buf, character);
+        }
+    }
+}
+
+void editorSetStatusMessage(const char *fmt, ...){
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(editor.statusmsg, sizeof(editor.statusmsg), fmt, ap);
+    va_end(ap);
+
+    editor.statusmsgTime = time(NULL);
+}
+
+void editorRefreshScreen(){
+    struct perfState *perf = &editor.perf;
+    struct timespec t0, t1, t2, t3, t4, t5;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    editorScroll();
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    if(editor.frame.numLines != editor.screenRows + 2){
+        for(int i = 0; i < editor.frame.numLines; i++){
+            abFree(&editor.frame.lines[i]);
+        }
+
+        editor.frame.numLines = editor.screenRows + 2;
+        editor.frame.lines = realloc(editor.frame.lines, sizeof(struct appendBuffer) * editor.frame.numLines);
+
+        for(int i = 0; i < editor.frame.numLines; i++){
+            editor.frame.lines[i].buffer = NULL;
+            editor.frame.lines[i].length = 0;
+            editor.frame.lines[i].capacity = 0;
+        }
+
+        editor.frame.valid = 0;
+    }
+
+    struct appendBuffer *ab = &editor.frame.output;
+
+    ab->length = 0;
+    abAppend(ab, "\x1b[?25l", 6);
+
+    editorScrollFrame(ab);
+    editorDrawRows(ab);
+
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    editorDrawStatusBar(ab);
+
+    clock_gettime(CLOCK_MONOTONIC, &t3);
+
+    editorDrawMessageBar(ab);
+
+    int cursorRow = (editor.cursorY - editor.rowOff) + 1;
+    int cursorColumn = (editor.renderX - editor.colOff) + 1;
+
+    editor.frame.bytes = 0;
+
+    if((ab->length > 6) || (cursorRow != editor.frame.cursorRow) || (cursorColumn != editor.frame.cursorColumn)){
+        abAppendCursor(ab, cursorRow, cursorColumn);
+        abAppend(ab, "\x1b[?25h", 6);
+
+        clock_gettime(CLOCK_MONOTONIC, &t4);
+
+        struct iovec iov = {ab->buffer, ab->length};
+
+        if(!editor.headless && (editorWriteAll(STDOUT_FILENO, &iov, 1) == -1)){
+            die("write");
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t5);
+
+        perf->writeNs = editorPerfPhase("write", &t4, &t5);
+
+        editor.frame.bytes = ab->length;
+        editor.frame.totalBytes += ab->length;
+        editor.frame.cursorRow = cursorRow;
+        editor.frame.cursorColumn = cursorColumn;
+    }
+
+    else{
+        perf->writeNs = 0;
+
+        clock_gettime(CLOCK_MONOTONIC, &t5);
+    }
+
+    editor.frame.valid = 1;
+
+    perf->scrollNs = editorPerfPhase("scroll", &t0, &t1);
+    perf->drawNs = editorPerfPhase("draw", &t1, &t2);
+    perf->countNs = editorPerfPhase("count", &t2, &t3);
+    perf->frameNs = editorPerfPhase("frame", &t0, &t5);
+
+    editor.frame.painted = t5;
+
+    if(perf->inputPending){
+        perf->latencyNs = editorPerfPhase("input to paint", &perf->input, &t5);
+        perf->inputPending = 0;
+    }
+}
+
+double editorPerfPhase(const char *name, struct timespec *start, struct timespec *end){
+    struct perfState *perf = &editor.perf;
+    double ns = editorElapsedNs(start, end);
+
+    if(perf->trace != NULL){
+        fprintf(perf->trace, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": %.3f, \"dur\": %.3f}", (perf->traceEvents > 0) ? ",\n" : "", name, editorElapsedNs(&perf->traceStart, start) / 1e3, ns / 1e3);
+
+        perf->traceEvents++;
+    }
+
+    return ns;
+}
+
+void editorTraceClose(){
+    if(editor.perf.trace != NULL){
+        fputs("\n]\n", editor.perf.trace);
+        fclose(editor.perf.trace);
+
+        editor.perf.trace = NULL;
+    }
+}
+
+void editorMoveCursor(int key){
+    erow *row = editorRowAt(editor.cursorY);
+
+    switch(key){
+        case ARROW_LEFT:
+            if(editor.cursorX != 0){
+                editor.cursorX--;
+            }
+            else if(editor.cursorY > 0){
+                editor.cursorY--;
+                editor.cursorX = editorRowAt(editor.cursorY)->size;
+            }
+            break;
+        case ARROW_RIGHT:
+            if(row && editor.cursorX < row->size){
+                editor.cursorX++;
+            }
+            else if(row && editor.cursorX == row->size){
+                editor.cursorY++;
+                editor.cursorX = 0;
+            }
+            break;
+        case ARROW_UP:
+            if(editor.cursorY != 0){
+                editor.cursorY--;
+            }
+            break;
+        case ARROW_DOWN:
+            if(editor.cursorY < editor.numRows){
+                editor.cursorY++;
+            }
+            break;
+    }
+
+    editorLoadRows(editor.cursorY + 1);
+
+    row = editorRowAt(editor.cursorY);
+    
+    int rowlen = row ? row->size : 0;
+
+    if(editor.cursorX > rowlen){
+        editor.cursorX = rowlen;
+    }
+}
+
+void abAppend(struct appendBuffer *ab, const char *s, int length){
+    if(length <= 0){
+        return;
+    }
+
+    if(ab->length + length > ab->capacity){
+        int capacity = ab->capacity ? ab->capacity : 64;
+
+        while(ab->length + length > capacity){
+            capacity *= 2;
+        }
+
+        char *new = realloc(ab->buffer, capacity);
+
+        if(new == NULL){
+            return;
+        }
+
+        ab->buffer = new;
+        ab->capacity = capacity;
+    }
+
+    memcpy(&ab->buffer[ab->length], s, length);
+
+    ab->length += length;
+}
+
+void abAppendCursor(struct appendBuffer *ab, int row, int column){
+    char buf[32];
+    int values[2] = {row, column};
+    int length = 0;
+
+    buf[length++] = '\x1b';
+    buf[length++] = '[';
+
+    for(int v = 0; v < 2; v++){
+        char digits[12];
+        int count = 0;
+        unsigned int value = (values[v] > 0) ? values[v] : 0;
+
+        do{
+            digits[count++] = '0' + (value % 10);
+            value /= 10;
+        } while(value > 0);
+
+        while(count > 0){
+            buf[length++] = digits[--count];
+        }
+
+        buf[length++] = (v == 0) ? ';' : 'H';
+    }
+
+    abAppend(ab, buf, length);
+}
+
+void abRotate(struct appendBuffer *lines, int count, int shift){
+    int ranges[3][2] = {{0, shift}, {shift, count}, {0, count}};
+
+    for(int r = 0; r < 3; r++){
+        for(int from = ranges[r][0], to = ranges[r][1] - 1; from < to; from++, to--){
+            struct appendBuffer swap = lines[from];
+
+            lines[from] = lines[to];
+            lines[to] = swap;
+        }
+    }
+}
+
+void abFree(struct appendBuffer *ab){
+    free(ab->buffer);
+
+    ab->buffer = NULL;
+    ab->length = 0;
+    ab->capacity = 0;
+}
+
+void die(const char *s){
+    if(!editor.headless){
+        write(STDOUT_FILENO, "\x1b[2J", 4);
+        write(STDOUT_FILENO, "\x1b[H", 3);
+    }
+
+    perror(s);
+    exit(1);
+}
+
+#ifdef VERTEXT_BENCH
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+
+void *malloc(size_t size){
+    __atomic_fetch_add(&editor.allocations, 1, __ATOMIC_RELAXED);
+
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size){
+    __atomic_fetch_add(&editor.allocations, 1, __ATOMIC_RELAXED);
+
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size){
+    __atomic_fetch_add(&editor.allocations, 1, __ATOMIC_RELAXED);
+
+    return __libc_realloc(pointer, size);
+}
+#endif
+
+double editorElapsedNs(struct timespec *start, struct timespec *end){
+    return ((end->tv_sec - start->tv_sec) * 1e9) + (end->tv_nsec - start->tv_nsec);
+}
+
+int editorBenchRows(){
+    int sizes[] = {10000, 100000, 1000000, 4000000};
+    int operations = 2000;
+
+    printf("%10s %16s %16s %16s %16s\n", "rows", "insert ns/op", "delete ns/op", "index ns/op", "heap B/line");
+
+    for(unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++){
+        struct timespec t0, t1, t2, t3;
+
+        editorFreeRows();
+
+        for(int i = 0; i < sizes[s]; i++){
+            editorInsertRow(editor.numRows, "lorem ipsum dolor sit amet", 26);
+        }
+
+        double heapPerLine = (double)(editor.slab.arenaBytes + editor.slab.largeBytes) / editor.numRows;
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+
+        for(int i = 0; i < operations; i++){
+            editorInsertRow(editor.numRows / 2, "x", 1);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        for(int i = 0; i < operations; i++){
+            editorDelRow(editor.numRows / 2);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+
+        volatile long checksum = 0;
+        unsigned int seed = 1;
+
+        for(int i = 0; i < operations; i++){
+            seed = (seed * 1103515245) + 12345;
+            checksum += editorRowAt(seed % editor.numRows)->size;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t3);
+
+        printf("%10d %16.0f %16.0f %16.0f %16.1f\n", sizes[s], editorElapsedNs(&t0, &t1) / operations, editorElapsedNs(&t1, &t2) / operations, editorElapsedNs(&t2, &t3) / operations, heapPerLine);
+    }
+
+    editorFreeRows();
+
+    return 0;
+}
+
+int editorCheckRow(int *ids, int at){
+    erow *row = editorRowAt(at);
+    char expected[16];
+    int length = snprintf(expected, sizeof(expected), "%d", ids[at]);
+
+    if((row == NULL) || (row->size != length) || (memcmp(editorRowChars(row), expected, length) != 0) || (editorRowIndex(row) != at)){
+        printf("row %d of %d: expected \"%s\"\n", at, editor.numRows, expected);
+
+        return 0;
+    }
+
+    return 1;
+}
+
+int editorCheckRowsInsert(int *ids, int at, int id){
+    char text[16];
+    int length = snprintf(text, sizeof(text), "%d", id);
+
+    memmove(&ids[at + 1], &ids[at], sizeof(int) * (editor.numRows - at));
+    ids[at] = id;
+    editorInsertRow(at, text, length);
+
+    return editorCheckRow(ids, at) && editorCheckRow(ids, rand() % editor.numRows);
+}
+
+int editorCheckRowsDelete(int *ids, int at){
+    memmove(&ids[at], &ids[at + 1], sizeof(int) * (editor.numRows - at - 1));
+    editorDelRow(at);
+
+    return (editor.numRows == 0) || (editorCheckRow(ids, (at < editor.numRows) ? at : (at - 1)) && editorCheckRow(ids, rand() % editor.numRows));
+}
+
+int editorCheckRows(){
+    int capacity = 400000;
+    int *ids = malloc(sizeof(int) * capacity);
+    int next = 0;
+    int ok = 1;
+
+    srand(1);
+    editorFreeRows();
+
+    for(int i = 0; ok && (i < ROW_BLOCK_SIZE); i++){
+        ok = editorCheckRowsInsert(ids, i, next++);
+    }
+
+    ok = ok && editorCheckRowsInsert(ids, 10, next++);
+
+    for(int i = 0; ok && (i < editor.numRows); i++){
+        ok = editorCheckRow(ids, rand() % editor.numRows);
+    }
+
+    while(ok && (editor.numRows < 300000)){
+        ok = editorCheckRowsInsert(ids, editor.numRows, next++);
+    }
+
+    for(int i = 0; ok && (i < 50000); i++){
+        ok = editorCheckRowsInsert(ids, 1000, next++);
+    }
+
+    for(int i = 0; ok && (i < 40000); i++){
+        if(rand() % 2){
+            ok = editorCheckRowsInsert(ids, rand() % (editor.numRows + 1), next++);
+        }
+        else{
+            ok = editorCheckRowsDelete(ids, rand() % editor.numRows);
+        }
+    }
+
+    while(ok && (editor.numRows > 1000)){
+        ok = editorCheckRowsDelete(ids, (editor.numRows > 200000) ? (rand() % editor.numRows) : (editor.numRows / 3));
+    }
+
+    for(int i = 0; ok && (i < editor.numRows); i++){
+        ok = editorCheckRow(ids, i);
+    }
+
+    while(ok && (editor.numRows > 0)){
+        ok = editorCheckRowsDelete(ids, rand() % editor.numRows);
+    }
+
+    printf("rows: %s (%d blocks, %d chunks left)\n", ok ? "ok" : "FAILED", editor.numBlocks, editor.numChunks);
+
+    editorFreeRows();
+    free(ids);
+
+    return ok ? 0 : 1;
+}
+
+int editorCheckUndo(){
+    char filler[100];
+    int run = 4096 - 128;
+    int ok = 1;
+
+    memset(filler, 'f', sizeof(filler));
+
+    editor.headless = 1;
+    initEditor();
+
+    editor.undo.limit = 4096;
+
+    for(int i = 0; i < 470; i++){
+        editor.undo.group++;
+        editorInsertRow(0, filler, sizeof(filler));
+    }
+
+    editor.cursorY = editor.numRows;
+    editor.cursorX = 0;
+
+    for(int i = 0; i < run; i++){
+        editor.undo.group++;
+        editorInsertChar('a' + (i % 26));
+    }
+
+    erow *row = editorRowAt(editor.numRows - 1);
+
+    ok = (row->size == run) && (editor.undo.start > 0);
+
+    editorUndo();
+
+    ok = ok && (editor.numRows == 470);
+
+    editorRedo();
+    row = editorRowAt(editor.numRows - 1);
+
+    for(int i = 0; ok && (i < run); i++){
+        ok = (editorRowChars(row)[i] == 'a' + (i % 26));
+    }
+
+    printf("undo: %s (%zu bytes of history)\n", ok ? "ok" : "FAILED", editor.undo.end - editor.undo.start);
+
+    editorFreeRows();
+    editorUndoReset();
+
+    return ok ? 0 : 1;
+}
+
+long long editorBenchFile(char *path, long long size, int lines){
+    int fd = mkstemp(path);
+
+    if(fd == -1){
+        die("mkstemp");
+    }
+
+    char *chunk = malloc(1024 * 1024);
+    long long written = 0;
+    int line = 0;
+
+    while((size > 0) ? (written < size) : (line < lines)){
+        int used = 0;
+
+        while((used < (1024 * 1024) - 128) && ((size > 0) || (line < lines))){
+            used += snprintf(&chunk[used], 128, "%d\tlorem ipsum dolor sit amet, consectetur %*s adipiscing elit\n", line, line % 40, "");
+            line++;
+        }
+
+        struct iovec iov = {chunk, used};
+
+        if(editorWriteAll(fd, &iov, 1) == -1){
+            die("write");
+        }
+
+        written += used;
+    }
+
+    free(chunk);
+    close(fd);
+
+    return written;
+}
+
+void editorCloseFile(){
+    editorFinishSave();
+    editorStopIndexing();
+    editorSwapDiscard();
+    editorFreeRows();
+    editorUndoReset();
+
+    if(editor.map != NULL){
+        munmap(editor.map, editor.mapSize);
+        close(editor.mapFd);
+    }
+
+    editor.map = NULL;
+    editor.mapSize = 0;
+    editor.mapIndexed = 0;
+    editor.mapFd = -1;
+
+    editor.cursorX = 0;
+    editor.cursorY = 0;
+    editor.rowOff = 0;
+    editor.colOff = 0;
+    editor.dirty = 0;
+
+    editorInvalidateFrame();
+}
+
+int editorBenchLoad(int argc, char *argv[]){
+    long defaults[] = {100, 1024, 5120};
+    int count = (argc > 0) ? argc : (int)(sizeof(defaults) / sizeof(defaults[0]));
+
+    editorInitIndex();
+
+    editor.swap.fd = -1;
+
+    printf("%10s %12s %8s %12s %12s %12s\n", "MB", "rows", "threads", "open ms", "index ms", "MB/s");
+
+    for(int s = 0; s < count; s++){
+        long megabytes = (argc > 0) ? atol(argv[s]) : defaults[s];
+        char path[] = "/tmp/vertext-bench-XXXXXX";
+        long long written = editorBenchFile(path, megabytes * 1024LL * 1024LL, 0);
+
+        struct timespec t0, t1, t2;
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        editorOpen(path);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        editorLoadAllRows();
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+
+        double seconds = editorElapsedNs(&t0, &t2) / 1e9;
+
+        printf("%10ld %12d %8d %12.1f %12.1f %12.1f\n", megabytes, editor.numRows, editor.index.numThreads, editorElapsedNs(&t0, &t1) / 1e6, editorElapsedNs(&t1, &t2) / 1e6, (written / (1024.0 * 1024.0)) / seconds);
+
+        editorCloseFile();
+
+        unlink(path);
+    }
+
+    return 0;
+}
+
+int editorLatencyCompare(const void *a, const void *b){
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+void editorReplay(const char *name, char *path, const char *script, size_t length){
+    struct timespec t0, t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    editorOpen(path);
+    editorLoadAllRows();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    double openMs = editorElapsedNs(&t0, &t1) / 1e6;
+    double *latencies = malloc(sizeof(double) * (length + 1));
+    int count = 0;
+    long long bytes = 0;
+
+    editor.input.script = script;
+    editor.input.scriptLength = length;
+    editor.input.scriptOffset = 0;
+    editor.input.start = 0;
+    editor.input.end = 0;
+
+    editorRefreshScreen();
+
+    long allocations = editor.allocations;
+
+    while(editorFillInput(0)){
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        editorProcessKeypress();
+        editorRefreshScreen();
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        latencies[count++] = editorElapsedNs(&t0, &t1);
+        bytes += editor.frame.bytes;
+
+        editorFinishSave();
+    }
+
+    allocations = editor.allocations - allocations;
+
+    qsort(latencies, count, sizeof(double), editorLatencyCompare);
+
+    double p50 = (count > 0) ? latencies[(count - 1) / 2] : 0;
+    double p99 = (count > 0) ? latencies[((count - 1) * 99) / 100] : 0;
+
+    printf("%-10s %10d %10.1f %8d %10.1f %10.1f %10.1f", name, editor.numRows, openMs, count, p50 / 1e3, p99 / 1e3, (count > 0) ? ((double)bytes / count) : 0);
+
+#ifdef VERTEXT_BENCH
+    printf(" %10.2f\n", (count > 0) ? ((double)allocations / count) : 0);
+#else
+    printf(" %10s\n", "-");
+#endif
+
+    free(latencies);
+
+    editor.input.script = NULL;
+    editor.input.scriptLength = 0;
+    editor.input.scriptOffset = 0;
+
+    editorCloseFile();
+}
+
+char *editorBenchScript(const char *scenario, size_t *length){
+    struct appendBuffer ab = ABUF_INIT;
+
+    if(strcmp(scenario, "typing") == 0){
+        const char *text = "the quick brown fox jumps over the lazy dog\r";
+        int textLength = strlen(text);
+
+        for(int i = 0; i < 10; i++){
+            abAppend(&ab, "\x1b[B", 3);
+        }
+
+        for(int i = 0; i < 2000; i++){
+            abAppend(&ab, (i % 50 == 49) ? "\x7f" : &text[i % textLength], 1);
+        }
+    }
+    else if(strcmp(scenario, "scrolling") == 0){
+        for(int i = 0; i < 500; i++){
+            abAppend(&ab, "\x1b[6~", 4);
+        }
+
+        for(int i = 0; i < 500; i++){
+            abAppend(&ab, "\x1b[B", 3);
+        }
+
+        for(int i = 0; i < 500; i++){
+            abAppend(&ab, "\x1b[5~", 4);
+        }
+    }
+    else if(strcmp(scenario, "pasting") == 0){
+        char line[64];
+
+        for(int i = 0; i < 20; i++){
+            abAppend(&ab, "\x1b[200~", 6);
+
+            for(int j = 0; j < 500; j++){
+                abAppend(&ab, line, snprintf(line, sizeof(line), "pasted line %d\twith some words\n", j));
+            }
+
+            abAppend(&ab, "\x1b[201~", 6);
+            abAppend(&ab, "\x1b[B", 3);
+        }
+    }
+    else if(strcmp(scenario, "saving") == 0){
+        for(int i = 0; i < 5; i++){
+            abAppend(&ab, "x", 1);
+            abAppend(&ab, "\x13", 1);
+        }
+    }
+    else{
+        abFree(&ab);
+
+        return NULL;
+    }
+
+    *length = ab.length;
+
+    return ab.buffer;
+}
+
+int editorBenchReplay(int argc, char *argv[]){
+    if(argc < 2){
+        fprintf(stderr, "Usage: vertext --replay SCRIPT FILE\n");
+
+        return 1;
+    }
+
+    int fd = open(argv[0], O_RDONLY);
+    struct stat st;
+
+    if((fd == -1) || (fstat(fd, &st) == -1)){
+        die("open");
+    }
+
+    char *script = NULL;
+
+    if(st.st_size > 0){
+        script = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if(script == MAP_FAILED){
+            die("mmap");
+        }
+    }
+
+    close(fd);
+
+    editor.headless = 1;
+    initEditor();
+
+    printf("%-10s %10s %10s %8s %10s %10s %10s %10s\n", "scenario", "rows", "open ms", "keys", "p50 us", "p99 us", "B/frame", "allocs/key");
+
+    editorReplay("replay", argv[1], script, st.st_size);
+
+    if(script != NULL){
+        munmap(script, st.st_size);
+    }
+
+    return 0;
+}
+
+int editorBench(int argc, char *argv[]){
+    const char *scenarios[] = {"typing", "scrolling", "pasting", "saving"};
+    int numScenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+    int defaults[] = {1000, 100000, 1000000, 10000000};
+    const char *scenario = (argc > 0) ? argv[0] : "all";
+    int count = (argc > 1) ? (argc - 1) : (int)(sizeof(defaults) / sizeof(defaults[0]));
+    int known = (strcmp(scenario, "all") == 0);
+
+    for(int i = 0; i < numScenarios; i++){
+        known = known || (strcmp(scenario, scenarios[i]) == 0);
+    }
+
+    if(!known){
+        fprintf(stderr, "Unknown scenario %s (typing, scrolling, pasting, saving or all)\n", scenario);
+
+        return 1;
+    }
+
+    editor.headless = 1;
+    initEditor();
+
+    printf("%-10s %10s %10s %8s %10s %10s %10s %10s\n", "scenario", "rows", "open ms", "keys", "p50 us", "p99 us", "B/frame", "allocs/key");
+
+    for(int s = 0; s < count; s++){
+        int lines = (argc > 1) ? atoi(argv[s + 1]) : defaults[s];
+
+        for(int i = 0; i < numScenarios; i++){
+            if((strcmp(scenario, "all") != 0) && (strcmp(scenario, scenarios[i]) != 0)){
+                continue;
+            }
+
+            size_t length;
+            char *script = editorBenchScript(scenarios[i], &length);
+            char path[] = "/tmp/vertext-bench-XXXXXX";
+
+            editorBenchFile(path, 0, lines);
+            editorReplay(scenarios[i], path, script, length);
+
+            unlink(path);
+            free(script);
+        }
+    }
+
+    return 0;
+}